@@ -17,6 +17,9 @@
 #include "CommonFunctions/Scatters.h"
 #include "CommonFunctions/Geometry.h"
 #include "CommonFunctions/Pandora.h"
+#include "CommonFunctions/TruthGraph.h"
+
+#include "Services/TruthGraphService.h"
 
 #include "larpandora/LArPandoraInterface/LArPandoraHelper.h"
 
@@ -101,7 +104,7 @@ public:
         p.true_vtx_sce_w_wire = (common::ProjectToWireView(p.true_vtx_sce_x, p.true_vtx_sce_y, p.true_vtx_sce_z, common::TPC_VIEW_W)).Z(); 
     }
 
-    void fillParticle(const art::ValidHandle<std::vector<simb::MCParticle>>& mcp_h, const art::Ptr<simb::MCParticle>& particle, Particle& p)
+    void fillParticle(const common::TruthGraph& truth_graph, const art::Ptr<simb::MCParticle>& particle, Particle& p)
     {
         p.tid = particle->TrackId();
         p.pdg = particle->PdgCode();
@@ -119,9 +122,9 @@ public:
         if (abs(particle->PdgCode()) == 211)
         {
             art::Ptr<simb::MCParticle> final_scatter_particle;
-            common::GetNScatters(mcp_h, particle, final_scatter_particle, p.n_elas, p.n_inelas);
+            common::GetNScatters(truth_graph, particle, final_scatter_particle, p.n_elas, p.n_inelas);
 
-            p.endstate = common::GetEndState(particle, mcp_h);
+            p.endstate = common::GetEndState(particle, truth_graph);
         }
     }
 
@@ -209,12 +212,7 @@ void EventCategoryAnalysis::analyzeEvent(art::Event const &e, bool is_data)
     auto const &mct_h = e.getValidHandle<std::vector<simb::MCTruth>>(_MCTproducer);
     auto const &mcp_h = e.getValidHandle<std::vector<simb::MCParticle>>(_MCPproducer);
 
-    std::map<int, art::Ptr<simb::MCParticle>> mcp_map;
-    for (size_t d = 0; d < mcp_h->size(); d++)
-    {
-        const art::Ptr<simb::MCParticle> mcp(mcp_h, d);
-        mcp_map[mcp->TrackId()] = mcp;
-    }
+    auto const truth_graph = art::ServiceHandle<TruthGraphService>()->graph(e, _MCPproducer);
 
     auto mct = mct_h->at(0);
     _found_signature = false;
@@ -231,8 +229,8 @@ void EventCategoryAnalysis::analyzeEvent(art::Event const &e, bool is_data)
             return;
         else
         {
-            art::Ptr<simb::MCParticle> lepton_ptr = mcp_map[lepton.TrackId()];
-            fillParticle(mcp_h, lepton_ptr, _mcp_mu);
+            art::Ptr<simb::MCParticle> lepton_ptr = truth_graph->at(lepton.TrackId());
+            fillParticle(*truth_graph, lepton_ptr, _mcp_mu);
         }
 
         for (const auto &t_part : *mcp_h)
@@ -247,15 +245,15 @@ void EventCategoryAnalysis::analyzeEvent(art::Event const &e, bool is_data)
         {
             if (abs(t_part.PdgCode()) == neutral_kaon->PdgCode() && t_part.Process() == "primary" && t_part.EndProcess() == "Decay" && t_part.NumberDaughters() == 1 && !_found_signature) 
             {
-                std::vector<art::Ptr<simb::MCParticle>> dtrs = common::GetDaughters(mcp_map.at(t_part.TrackId()), mcp_map);
+                auto dtrs = truth_graph->daughters(t_part.TrackId());
                 if (dtrs.size() != 1) 
                     continue; 
 
                 auto g_part = dtrs.at(0);
                 if (g_part->PdgCode() == kaon_short->PdgCode() && g_part->Process() == "Decay" && g_part->EndProcess() == "Decay" && g_part->NumberDaughters() == 2 && !_found_signature)
                 {
-                    fillParticle(mcp_h, g_part, _mcp_kshort);
-                    auto daughters = common::GetDaughters(mcp_map.at(g_part->TrackId()), mcp_map);
+                    fillParticle(*truth_graph, g_part, _mcp_kshort);
+                    auto daughters = truth_graph->daughters(g_part->TrackId());
                     if (daughters.size() == 2) 
                     {
                         std::vector<int> exp_dtrs = {-211, 211};
@@ -278,14 +276,14 @@ void EventCategoryAnalysis::analyzeEvent(art::Event const &e, bool is_data)
                                 art::Ptr<simb::MCParticle> scat_part;
                                 std::string scat_end_process;
 
-                                common::GetNScatters(mcp_h, dtr, scat_part, n_elas, n_inelas);
-                                scat_end_process = common::GetEndState(dtr, mcp_h);
+                                common::GetNScatters(*truth_graph, dtr, scat_part, n_elas, n_inelas);
+                                scat_end_process = common::GetEndState(dtr, *truth_graph);
 
                                 if (dtr->PdgCode() == 211) // pion-plus
-                                    fillParticle(mcp_h, dtr, _mcp_piplus);
+                                    fillParticle(*truth_graph, dtr, _mcp_piplus);
                                 
                                 else if (dtr->PdgCode() == -211) // pion-minus
-                                    fillParticle(mcp_h, dtr, _mcp_piminus);
+                                    fillParticle(*truth_graph, dtr, _mcp_piminus);
                             }
 
                             _found_signature = std::all_of(daughters.begin(), daughters.end(), [&](const auto &dtr) 
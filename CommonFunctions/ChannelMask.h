@@ -0,0 +1,92 @@
+#ifndef CHANNELMASK_H
+#define CHANNELMASK_H
+
+#include "larcoreobj/SimpleTypesAndConstants/RawTypes.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace common
+{
+    // Packed per-channel flag with a per-word prefix count, so that both a
+    // single channel and "any flagged channel in [lo, hi]" are answered in
+    // constant time. Call finalise() after the last set().
+    class ChannelMask
+    {
+    public:
+        ChannelMask() = default;
+
+        explicit ChannelMask(size_t n_channels)
+            : _n_channels{n_channels}
+            , _bits((n_channels + 63) / 64, 0)
+            , _prefix(_bits.size() + 1, 0)
+        {}
+
+        void set(raw::ChannelID_t channel)
+        {
+            if (channel < _n_channels)
+                _bits[channel / 64] |= uint64_t(1) << (channel % 64);
+        }
+
+        void finalise()
+        {
+            for (size_t w = 0; w < _bits.size(); ++w)
+                _prefix[w + 1] = _prefix[w] + __builtin_popcountll(_bits[w]);
+        }
+
+        size_t size() const { return _n_channels; }
+        size_t count() const { return _prefix.empty() ? 0 : _prefix.back(); }
+
+        bool bad(raw::ChannelID_t channel) const
+        {
+            return channel < _n_channels && (_bits[channel / 64] >> (channel % 64)) & 1;
+        }
+
+        // Number of flagged channels in [lo, hi], clamped to the detector.
+        size_t count(long lo, long hi) const
+        {
+            lo = std::max(lo, 0L);
+            hi = std::min(hi, static_cast<long>(_n_channels) - 1);
+            if (lo > hi)
+                return 0;
+
+            return this->rank(hi + 1) - this->rank(lo);
+        }
+
+        bool anyBad(long lo, long hi) const { return this->count(lo, hi) > 0; }
+
+        // Writes 1 to flags[i] for every channels[i] that is flagged.
+        void flag(const std::vector<raw::ChannelID_t>& channels, std::vector<unsigned char>& flags) const
+        {
+            flags.resize(channels.size());
+            for (size_t i = 0; i < channels.size(); ++i)
+                flags[i] = this->bad(channels[i]);
+        }
+
+        // Drops, in place and in one pass, every element whose channel is
+        // flagged; channel_of maps an element to its channel.
+        template <typename T, typename ChannelOf>
+        void removeBad(std::vector<T>& items, ChannelOf channel_of) const
+        {
+            items.erase(std::remove_if(items.begin(), items.end(), [&](const T& item) { return this->bad(channel_of(item)); }), items.end());
+        }
+
+    private:
+        size_t _n_channels = 0;
+        std::vector<uint64_t> _bits;
+        std::vector<uint32_t> _prefix;
+
+        size_t rank(size_t channel) const
+        {
+            const size_t word = channel / 64;
+            const size_t bit = channel % 64;
+            size_t n = _prefix[word];
+            if (bit > 0)
+                n += __builtin_popcountll(_bits[word] & ((uint64_t(1) << bit) - 1));
+            return n;
+        }
+    };
+}
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <map>
 
+#include "CommonFunctions/ProximityClusterer.h"
+
 #include "lardataobj/RecoBase/Hit.h"
 #include "lardataobj/RecoBase/Vertex.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
@@ -13,308 +15,115 @@
 
 namespace common 
 {
-    void MakeHitMap(const std::vector< art::Ptr<recob::Hit> >& hitlist,
-            int plane,
-            const float& _time2cm, const float& _wire2cm,
-            const float& _cellSize,
-            std::map<std::pair<int,int>, std::vector<size_t> >& _hitMap) 
+    ClusterHit MakeClusterHit(const recob::Hit& hit)
     {
-        _hitMap.clear();
-
-        std::pair<int,int> tmpPair;
-        
-        for (size_t h=0; h < hitlist.size(); h++){
-        
-        auto const& hit = hitlist.at(h);
-        if (hit->View() != plane)
-        continue;
-
-        double t = hit->PeakTime() * _time2cm;
-        double w = hit->WireID().Wire * _wire2cm;
-
-        // map is (i,j) -> hit list
-        // i : ith bin in wire of some width
-        // j : jth bin in time of some width
-        int i = int(w / _cellSize);
-        int j = int(t / _cellSize);
-        tmpPair = std::make_pair(i,j);
-
-        if (_hitMap.find(tmpPair) == _hitMap.end()){
-            std::vector<size_t> aaa = {h};
-            _hitMap[tmpPair] = aaa;
-        }
-        else
-            _hitMap[tmpPair].push_back(h);
-        }
+        return ClusterHit{static_cast<int>(hit.View()), hit.WireID().Plane, hit.WireID().Wire, hit.Channel(), hit.PeakTime(), hit.RMS()};
+    }
 
-        return;
+    void MakeClusterHits(const std::vector< art::Ptr<recob::Hit> >& hitlist, std::vector<ClusterHit>& hits)
+    {
+        hits.clear();
+        hits.reserve(hitlist.size());
+        for (auto const& hit : hitlist)
+            hits.push_back(MakeClusterHit(*hit));
     }
 
     bool TimeOverlap(const art::Ptr<recob::Hit>& h1, const art::Ptr<recob::Hit>& h2, const float& _time2cm, double& dmin) 
     {
-        auto T1 = h1->PeakTime() * _time2cm; // time of first hit
-        auto T2 = h2->PeakTime() * _time2cm;
-        auto W1 = h1->RMS() * _time2cm;
-        auto W2 = h2->RMS() * _time2cm;
-        
-        double d = dmin;
-        
-        if (T1 > T2) {
-            if ( (T2+W2) > (T1-W1) ) return true;
-            
-            d = (T1-W1) - (T2+W2);
-            if (d < dmin) dmin = d;
-        }
-        
-        else {
-            if ( (T1+W1) > (T2-W2) ) return true;
-            
-            d = (T2-W2) - (T1+W1);
-            if (d < dmin) dmin = d;
-        }
-        
-        return false;
+        return TimeOverlap(MakeClusterHit(*h1), MakeClusterHit(*h2), _time2cm, dmin);
     }
 
-    bool HitsCompatible(const art::Ptr<recob::Hit>& h1, const art::Ptr<recob::Hit>& h2, const float& _time2cm, const float& _wire2cm, const float& _radius) {
-
-        if (h1->WireID().Plane != h2->WireID().Plane)
-            return false;
-        
-        double dt = ( h1->PeakTime() - h2->PeakTime() ) * _time2cm;
-
-        if (TimeOverlap(h1,h2,_time2cm,dt) == true)
-            dt = 0;
-        
-        double dw = fabs(((double)h1->Channel()-(double)h2->Channel())*_wire2cm);
-        if (dw >  0.3) dw -= 0.3;
-
-        double d = dt*dt + dw*dw;
-
-        if (d > (_radius*_radius))
-            return false;
-
-        return true;
+    bool HitsCompatible(const art::Ptr<recob::Hit>& h1, const art::Ptr<recob::Hit>& h2, const float& _time2cm, const float& _wire2cm, const float& _radius) 
+    {
+        return HitsCompatible(MakeClusterHit(*h1), MakeClusterHit(*h2), _time2cm, _wire2cm, _radius);
     }
 
-
-    /// Function to get neighboring hits (from self + neighoring cells)
-    void getNeighboringHits(const std::pair<int,int>& pair, std::vector<size_t>& hitIndices,
-                std::map<std::pair<int,int>, std::vector<size_t> >& _hitMap) 
+    /// Proximity clustering (see ProximityClusterer) configured once per job.
+    /// The wire and time conversions are read from the geometry and detector
+    /// properties at construction and by updateDetector(), which should be
+    /// called again whenever those change (e.g. in beginRun). Each plane keeps
+    /// its clusterer, and with it its cell grid and union-find arenas, from one
+    /// call to the next. Not safe for concurrent use; shared modules need one
+    /// per schedule or a lock around it.
+    class Clusterer
     {
-        auto const& i       = pair.first;
-        // time-space cell index
-        auto const& j       = pair.second;
+    public:
+        using Clusters = std::vector<std::vector<unsigned int> >;
 
-        // _________
-        // |__|__|__|
-        // |__|XX|__|
-        // |__|__|__|
-        if (_hitMap.find(std::make_pair(i,j)) != _hitMap.end()){
-        for (auto &h : _hitMap[std::make_pair(i,j)])
-        hitIndices.push_back(h);
+        Clusterer(float cellSize, float radius, const std::vector<int>& planes = {2}, bool parallel = false)
+            : _cellSize{cellSize}, _radius{radius}, _planes{planes}, _parallel{parallel}
+        {
+            this->updateDetector();
         }
 
-        // now look at neighboring cells, if they exist
-        // _________
-        // |__|__|__|
-        // |XX|__|__|
-        // |__|__|__|
-        if (_hitMap.find(std::make_pair(i-1,j)) != _hitMap.end()){
-        for (auto &h : _hitMap[std::make_pair(i-1,j)])
-        hitIndices.push_back(h);
-        }
-        // _________
-        // |__|__|__|
-        // |__|__|__|
-        // |__|XX|__|
-        if (_hitMap.find(std::make_pair(i,j-1)) != _hitMap.end()){
-        for (auto &h : _hitMap[std::make_pair(i,j-1)])
-        hitIndices.push_back(h);
+        void updateDetector()
+        {
+            auto const* geom = ::lar::providerFrom<geo::Geometry>();
+            auto const* detp = lar::providerFrom<detinfo::DetectorPropertiesService>();
+            double _wire2cm = geom->WirePitch(0,0,0);
+            double _time2cm = detp->SamplingRate() / 1000.0 * detp->DriftVelocity( detp->Efield(), detp->Temperature() );
+
+            if (_clusterers.empty())
+                _clusterers.assign(_planes.size(), ProximityClusterer(_cellSize, _radius, _wire2cm, _time2cm));
+            for (auto& clusterer : _clusterers)
+                clusterer.setConversions(_wire2cm, _time2cm);
         }
-        // _________
-        // |__|__|__|
-        // |__|__|__|
-        // |XX|__|__|
-        if ( _hitMap.find(std::make_pair(i-1,j-1)) != _hitMap.end() ){
-        for (auto &h : _hitMap[std::make_pair(i-1,j-1)])
-        hitIndices.push_back(h);
-        }
-        // _________
-        // |__|XX|__|
-        // |__|__|__|
-        // |__|__|__|
-        if ( _hitMap.find(std::make_pair(i,j+1)) != _hitMap.end() ){
-        for (auto &h : _hitMap[std::make_pair(i,j+1)])
-        hitIndices.push_back(h);
-        }
-        // _________
-        // |__|__|__|
-        // |__|__|XX|
-        // |__|__|__|
-        if ( _hitMap.find(std::make_pair(i+1,j)) != _hitMap.end() ){
-        for (auto &h : _hitMap[std::make_pair(i+1,j)])
-        hitIndices.push_back(h);
-        }
-        // _________
-        // |__|__|XX|
-        // |__|__|__|
-        // |__|__|__|
-        if ( _hitMap.find(std::make_pair(i+1,j+1)) != _hitMap.end() ){
-        for (auto &h : _hitMap[std::make_pair(i+1,j+1)])
-        hitIndices.push_back(h);
-        }
-        // _________
-        // |XX|__|__|
-        // |__|__|__|
-        // |__|__|__|
-        if ( _hitMap.find(std::make_pair(i-1,j+1)) != _hitMap.end() ){
-        for (auto &h : _hitMap[std::make_pair(i-1,j+1)])
-        hitIndices.push_back(h);
+
+        /// Appends the clusters of each plane in turn, as indices into hit_ptr_v.
+        bool cluster(const std::vector< art::Ptr<recob::Hit> >& hit_ptr_v, Clusters& _out_cluster_vector)
+        {
+            if (hit_ptr_v.size() == 0)
+                return false;
+
+            MakeClusterHits(hit_ptr_v, _hits);
+            ClusterViews(_clusterers, _hits, _planes, _parallel, _out_cluster_vector);
+            return true;
         }
-        // _________
-        // |__|__|__|
-        // |__|__|__|
-        // |__|__|XX|
-        if ( _hitMap.find(std::make_pair(i+1,j-1)) != _hitMap.end() ){
-        for (auto &h : _hitMap[std::make_pair(i+1,j-1)])
-        hitIndices.push_back(h);
+
+        /// Clusters each hit subset (e.g. the hits of each slice) on its own;
+        /// out[s] holds the clusters of subsets[s], as indices into it.
+        void cluster(const std::vector<std::vector< art::Ptr<recob::Hit> > >& subsets, std::vector<Clusters>& out)
+        {
+            out.resize(subsets.size());
+            for (size_t s = 0; s < subsets.size(); ++s)
+            {
+                out[s].clear();
+                this->cluster(subsets[s], out[s]);
+            }
         }
-    }
 
+    private:
+        float _cellSize, _radius;
+        std::vector<int> _planes;
+        bool _parallel;
+
+        std::vector<ProximityClusterer> _clusterers;
+        std::vector<ClusterHit> _hits;
+    };
+
+    /// Proximity clustering of the hits of the given planes, one thread per
+    /// plane when parallel; clusters are appended plane by plane, as indices
+    /// into hit_ptr_v. Reads the detector constants on every call, so jobs
+    /// clustering every event should keep a Clusterer instead.
     bool cluster(const std::vector< art::Ptr<recob::Hit> >& hit_ptr_v,
             std::vector<std::vector<unsigned int> >& _out_cluster_vector,
-            const float& cellSize, const float& radius) 
+            const float& cellSize, const float& radius,
+            const std::vector<int>& planes, bool parallel = false) 
     {
         if (hit_ptr_v.size() == 0)
         return false;
         
-        double _cellSize = cellSize;
-        double _radius = radius;
-        double _wire2cm, _time2cm;
-        
-        auto const* geom = ::lar::providerFrom<geo::Geometry>();
-        auto const* detp = lar::providerFrom<detinfo::DetectorPropertiesService>();
-        _wire2cm = geom->WirePitch(0,0,0);
-        _time2cm = detp->SamplingRate() / 1000.0 * detp->DriftVelocity( detp->Efield(), detp->Temperature() );
-        
-        std::map<std::pair<int,int>, std::vector<size_t> > _hitMap;
-        std::map<size_t, size_t> _clusterMap;
-        std::map<size_t,std::vector<size_t> > _clusters;
-
-        size_t maxClusterID = 0;
-
-        //for (int pl=0; pl < 3; pl++){
-
-            int pl = 2; // change to just look at the collection plane
-        
-            MakeHitMap(hit_ptr_v,pl,_time2cm, _wire2cm, _cellSize, _hitMap);
-        
-            std::map<std::pair<int,int>, std::vector<size_t> >::iterator it;
-        
-            for (it = _hitMap.begin(); it != _hitMap.end(); it++){
-                auto const& pair = it->first;
-            
-                // wire-space cell index
-                // prepare a hit list of all neighboring cells
-                // _________
-                // |__|__|__|
-                // |__|__|__|
-                // |__|__|__|
-                std::vector<size_t> cellhits = it->second;
-
-                std::vector<size_t> neighborhits;
-                getNeighboringHits(pair,neighborhits, _hitMap);
-
-                for (size_t h1=0; h1 < cellhits.size(); h1++){
-                    // has this hit been added to a cluster?
-                    // if so not necessary to look at
-                    auto const& hit1 = cellhits[h1];
-                    // keep track if the hit will ever be matched to another
-                    bool matched = false;
-                    // if not find hits it should be clustered with and add it to the appropriate cluster
-                    for (size_t h2=0; h2 < neighborhits.size(); h2++){
-                        auto const& hit2 = neighborhits[h2];
-                        if (hit1 == hit2) continue;
-                        // are the hits compatible?
-                        bool compat = HitsCompatible(hit_ptr_v.at(hit1),
-                                    hit_ptr_v.at(hit2),
-                                    _time2cm, _wire2cm, _radius);
-                        // should the hits go in the same cluster?
-                        if (compat){
-                        matched = true;
-                        // if both hits have already been assigned to a cluster then we can merge the cluster indices!
-                            if ( (_clusterMap.find(hit1) != _clusterMap.end()) and
-                            (_clusterMap.find(hit2) != _clusterMap.end()) ){
-                                // if in the same cluster -> do nothing
-                                // if they are in different clusters:
-                                if (_clusterMap[hit1] != _clusterMap[hit2]){
-                                    auto idx1 = _clusterMap[hit1];
-                                    auto idx2 = _clusterMap[hit2];
-                                    // hit indices for 1st cluster:
-                                    auto hits1 = _clusters[idx1];
-                                    auto hits2 = _clusters[idx2];
-                                    // append hits2 to hits1
-                                    for (auto h : hits2){
-                                        hits1.push_back(h);
-                                        // also change the index that the hit goes to (idx1 instead of idx2)
-                                        _clusterMap[h] = idx1;
-                                    }
-                                    _clusters[idx1] = hits1;
-                                    // erase cluster @ index2
-                                    _clusters.erase(idx2);
-                                }// if they are in different clusters
-                            }
-                            // if compatible and the 2nd hit has been added to a cluster
-                            // add hit1 to the same cluster
-                            else if ( (_clusterMap.find(hit2) != _clusterMap.end()) and
-                                (_clusterMap.find(hit1) == _clusterMap.end()) ){
-                                auto clusIdx = _clusterMap[hit2];
-                                _clusterMap[hit1] = clusIdx;
-                                _clusters[clusIdx].push_back(hit1);
-                            }
-                            // otherwise, add both to a new cluster
-                            else if ( (_clusterMap.find(hit1) != _clusterMap.end()) and
-                                (_clusterMap.find(hit2) == _clusterMap.end()) ){
-                                auto clusIdx = _clusterMap[hit1];
-                                _clusterMap[hit2] = clusIdx;
-                                _clusters[clusIdx].push_back(hit2);
-                            }
-                            // if neither has a cluster yet
-                            else{
-                                // create a new cluster for this match
-                                _clusterMap[hit1] = maxClusterID;
-                                _clusterMap[hit2] = maxClusterID;
-                                std::vector<size_t> cl = {hit1,hit2};
-                                _clusters[maxClusterID] = cl;
-                                maxClusterID += 1;
-                            }
-                        }// if the two hits are compatible
-                    }// 2nd loop through hits in the cell
-                    // has this hit been matched? if not we still need to add it as its own cluster
-                    if (matched == false){
-                        _clusterMap[hit1] = maxClusterID;
-                        _clusters[maxClusterID] = {hit1};
-                        maxClusterID += 1;
-                    }
-                }// 1st loop through hits in the cell
-            //}// loop through all cells
-        }// loop through all planes
+        Clusterer clusterer(cellSize, radius, planes, parallel);
+        return clusterer.cluster(hit_ptr_v, _out_cluster_vector);
+    }
 
-        // make a vector for the clusters
-        for (auto it = _clusters.begin(); it != _clusters.end(); it++){
-            auto indices = it->second;
-            // if there are enough indices, make a cluster
-            if (indices.size() >= 1){
-                std::vector<unsigned int> clus;
-                for (auto idx : indices)
-                    clus.push_back(idx);
-                _out_cluster_vector.push_back(clus);
-            }// if there are 2 hits in cluster
-        }
-        
-        return true;
+    /// Collection plane only.
+    bool cluster(const std::vector< art::Ptr<recob::Hit> >& hit_ptr_v,
+            std::vector<std::vector<unsigned int> >& _out_cluster_vector,
+            const float& cellSize, const float& radius) 
+    {
+        return cluster(hit_ptr_v, _out_cluster_vector, cellSize, radius, {2});
     }
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,315 @@
+#include "CommonFunctions/ProximityClusterer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Times common::ProximityClusterer against the map-based implementation it
+// replaced, on synthetic dense events, and checks that both give the same
+// clusters. Events hold straight tracks, electromagnetic-shower-like blobs
+// and noise hits on the three planes of a MicroBooNE-sized readout.
+//
+//   clustering_benchmark [--events 20] [--hits 20000] [--cell-size 2.0]
+//       [--radius 1.0] [--iterations 3] [--seed 12345] [--output result.json]
+//
+// The reference clusters the collection plane only, as the old
+// common::cluster did; the new clusterer is timed on that plane, and on all
+// three planes with fresh clusterers per event and, as common::Clusterer
+// runs, with clusterers kept across events, serially and in parallel. The results are
+// printed as one JSON document; a mismatch makes the exit status non-zero.
+
+namespace
+{
+    using Clusters = std::vector<std::vector<unsigned int>>;
+
+    constexpr float kWire2cm = 0.3f;
+    constexpr float kTime2cm = 0.0549f;
+    const unsigned int kWires[3] = {2400, 2400, 3456};
+    const unsigned int kChannelOffset[3] = {0, 2400, 4800};
+    constexpr float kTicks = 6400.f;
+
+    // The implementation before ProximityClusterer, step for step, reading
+    // ClusterHit instead of recob::Hit.
+    namespace reference
+    {
+        using HitMap = std::map<std::pair<int,int>, std::vector<size_t> >;
+
+        void MakeHitMap(const std::vector<common::ClusterHit>& hitlist, int plane, const float& _time2cm, const float& _wire2cm, const float& _cellSize, HitMap& _hitMap)
+        {
+            _hitMap.clear();
+            for (size_t h=0; h < hitlist.size(); h++){
+                auto const& hit = hitlist.at(h);
+                if (hit.view != plane)
+                    continue;
+
+                double t = hit.peak_time * _time2cm;
+                double w = hit.wire * _wire2cm;
+                int i = int(w / _cellSize);
+                int j = int(t / _cellSize);
+                _hitMap[std::make_pair(i,j)].push_back(h);
+            }
+        }
+
+        void getNeighboringHits(const std::pair<int,int>& pair, std::vector<size_t>& hitIndices, HitMap& _hitMap)
+        {
+            static const int offsets[9][2] = {{0, 0}, {-1, 0}, {0, -1}, {-1, -1}, {0, 1}, {1, 0}, {1, 1}, {-1, 1}, {1, -1}};
+            for (const auto& offset : offsets) {
+                auto it = _hitMap.find(std::make_pair(pair.first + offset[0], pair.second + offset[1]));
+                if (it != _hitMap.end()) {
+                    for (auto &h : it->second)
+                        hitIndices.push_back(h);
+                }
+            }
+        }
+
+        void cluster(const std::vector<common::ClusterHit>& hits, int pl, float _cellSize, float _radius, float _wire2cm, float _time2cm, Clusters& _out_cluster_vector)
+        {
+            HitMap _hitMap;
+            std::map<size_t, size_t> _clusterMap;
+            std::map<size_t,std::vector<size_t> > _clusters;
+            size_t maxClusterID = 0;
+
+            MakeHitMap(hits, pl, _time2cm, _wire2cm, _cellSize, _hitMap);
+            for (auto it = _hitMap.begin(); it != _hitMap.end(); it++){
+                std::vector<size_t> cellhits = it->second;
+                std::vector<size_t> neighborhits;
+                getNeighboringHits(it->first, neighborhits, _hitMap);
+
+                for (size_t h1=0; h1 < cellhits.size(); h1++){
+                    auto const& hit1 = cellhits[h1];
+                    bool matched = false;
+                    for (size_t h2=0; h2 < neighborhits.size(); h2++){
+                        auto const& hit2 = neighborhits[h2];
+                        if (hit1 == hit2) continue;
+                        if (!common::HitsCompatible(hits.at(hit1), hits.at(hit2), _time2cm, _wire2cm, _radius))
+                            continue;
+
+                        matched = true;
+                        if ( (_clusterMap.find(hit1) != _clusterMap.end()) and (_clusterMap.find(hit2) != _clusterMap.end()) ){
+                            if (_clusterMap[hit1] != _clusterMap[hit2]){
+                                auto idx1 = _clusterMap[hit1];
+                                auto idx2 = _clusterMap[hit2];
+                                auto hits1 = _clusters[idx1];
+                                auto hits2 = _clusters[idx2];
+                                for (auto h : hits2){
+                                    hits1.push_back(h);
+                                    _clusterMap[h] = idx1;
+                                }
+                                _clusters[idx1] = hits1;
+                                _clusters.erase(idx2);
+                            }
+                        }
+                        else if ( (_clusterMap.find(hit2) != _clusterMap.end()) and (_clusterMap.find(hit1) == _clusterMap.end()) ){
+                            auto clusIdx = _clusterMap[hit2];
+                            _clusterMap[hit1] = clusIdx;
+                            _clusters[clusIdx].push_back(hit1);
+                        }
+                        else if ( (_clusterMap.find(hit1) != _clusterMap.end()) and (_clusterMap.find(hit2) == _clusterMap.end()) ){
+                            auto clusIdx = _clusterMap[hit1];
+                            _clusterMap[hit2] = clusIdx;
+                            _clusters[clusIdx].push_back(hit2);
+                        }
+                        else{
+                            _clusterMap[hit1] = maxClusterID;
+                            _clusterMap[hit2] = maxClusterID;
+                            _clusters[maxClusterID] = {hit1,hit2};
+                            maxClusterID += 1;
+                        }
+                    }
+                    if (matched == false){
+                        _clusterMap[hit1] = maxClusterID;
+                        _clusters[maxClusterID] = {hit1};
+                        maxClusterID += 1;
+                    }
+                }
+            }
+
+            for (auto it = _clusters.begin(); it != _clusters.end(); it++)
+                _out_cluster_vector.emplace_back(it->second.begin(), it->second.end());
+        }
+    }
+
+    common::ClusterHit makeHit(int plane, double wire, double tick, float rms)
+    {
+        const unsigned int w = static_cast<unsigned int>(std::min(std::max(wire, 0.), kWires[plane] - 1.));
+        const float t = static_cast<float>(std::min(std::max(tick, 0.), static_cast<double>(kTicks)));
+        return common::ClusterHit{plane, static_cast<unsigned int>(plane), w, kChannelOffset[plane] + w, t, rms};
+    }
+
+    // About half the hits on tracks, a third in showers and the rest noise,
+    // shared evenly between the planes.
+    std::vector<std::vector<common::ClusterHit>> syntheticEvents(size_t n_events, size_t n_hits, unsigned int seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<double> unit(0., 1.);
+        std::normal_distribution<double> gauss(0., 1.);
+        std::uniform_real_distribution<float> rms_dist(2.f, 8.f);
+
+        std::vector<std::vector<common::ClusterHit>> events(n_events);
+        for (auto& event : events)
+        {
+            event.reserve(n_hits);
+            for (int plane = 0; plane < 3; ++plane)
+            {
+                const size_t plane_hits = n_hits / 3;
+                const size_t track_hits = plane_hits / 2, shower_hits = plane_hits / 3;
+
+                for (size_t n = 0; n < track_hits; n += 200)
+                {
+                    const double w0 = unit(rng) * kWires[plane], t0 = unit(rng) * kTicks;
+                    const double angle = unit(rng) * 2. * M_PI;
+                    for (size_t k = 0; k < std::min<size_t>(200, track_hits - n); ++k)
+                        event.push_back(makeHit(plane, w0 + 0.5 * k * std::cos(angle), t0 + 10. * k * std::sin(angle) + gauss(rng), rms_dist(rng)));
+                }
+
+                for (size_t n = 0; n < shower_hits; n += 300)
+                {
+                    const double w0 = unit(rng) * kWires[plane], t0 = unit(rng) * kTicks;
+                    for (size_t k = 0; k < std::min<size_t>(300, shower_hits - n); ++k)
+                        event.push_back(makeHit(plane, w0 + 15. * gauss(rng), t0 + 150. * gauss(rng), rms_dist(rng)));
+                }
+
+                for (size_t n = track_hits + shower_hits; n < plane_hits; ++n)
+                    event.push_back(makeHit(plane, unit(rng) * kWires[plane], unit(rng) * kTicks, rms_dist(rng)));
+            }
+
+            std::shuffle(event.begin(), event.end(), rng);
+        }
+
+        return events;
+    }
+
+    template <typename Run>
+    double timeRuns(const std::vector<std::vector<common::ClusterHit>>& events, int iterations, Run&& run, size_t& n_clusters)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int it = 0; it < iterations; ++it)
+        {
+            n_clusters = 0;
+            for (const auto& event : events)
+                n_clusters += run(event);
+        }
+        auto finish = std::chrono::steady_clock::now();
+
+        return std::chrono::duration<double>(finish - start).count() / (iterations * events.size());
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::map<std::string, std::string> args = {
+        {"events", "20"}, {"hits", "20000"}, {"cell-size", "2.0"}, {"radius", "1.0"}, {"iterations", "3"}, {"seed", "12345"}};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string key = argv[i];
+        if (key.rfind("--", 0) != 0 || i + 1 >= argc)
+        {
+            std::cerr << "Usage: " << argv[0] << " [--events N] [--hits N] [--cell-size CM] [--radius CM] [--iterations N] [--seed N] [--output FILE]" << std::endl;
+            return 1;
+        }
+        args[key.substr(2)] = argv[++i];
+    }
+
+    try {
+        const float cell_size = std::stof(args["cell-size"]);
+        const float radius = std::stof(args["radius"]);
+        const int iterations = std::stoi(args["iterations"]);
+        const auto events = syntheticEvents(std::stoul(args["events"]), std::stoul(args["hits"]), std::stoul(args["seed"]));
+
+        size_t n_mismatched = 0;
+        common::ProximityClusterer clusterer(cell_size, radius, kWire2cm, kTime2cm);
+        for (const auto& event : events)
+        {
+            Clusters expected, plane_clusters, view_clusters;
+            for (int plane = 0; plane < 3; ++plane)
+                reference::cluster(event, plane, cell_size, radius, kWire2cm, kTime2cm, expected);
+
+            clusterer.cluster(event, 2, plane_clusters);
+            common::ClusterViews(event, {0, 1, 2}, cell_size, radius, kWire2cm, kTime2cm, true, view_clusters);
+
+            Clusters expected_plane;
+            reference::cluster(event, 2, cell_size, radius, kWire2cm, kTime2cm, expected_plane);
+            if (plane_clusters != expected_plane || view_clusters != expected)
+                n_mismatched += 1;
+        }
+
+        struct Result { std::string name; double seconds; size_t n_clusters; };
+        std::vector<Result> results;
+        size_t n_clusters = 0;
+
+        double seconds = timeRuns(events, iterations, [&](const auto& event) {
+            Clusters out;
+            reference::cluster(event, 2, cell_size, radius, kWire2cm, kTime2cm, out);
+            return out.size();
+        }, n_clusters);
+        results.push_back({"reference_plane2", seconds, n_clusters});
+
+        seconds = timeRuns(events, iterations, [&](const auto& event) {
+            Clusters out;
+            clusterer.cluster(event, 2, out);
+            return out.size();
+        }, n_clusters);
+        results.push_back({"clusterer_plane2", seconds, n_clusters});
+
+        seconds = timeRuns(events, iterations, [&](const auto& event) {
+            Clusters out;
+            common::ClusterViews(event, {0, 1, 2}, cell_size, radius, kWire2cm, kTime2cm, false, out);
+            return out.size();
+        }, n_clusters);
+        results.push_back({"clusterer_all_planes_fresh", seconds, n_clusters});
+
+        // As common::Clusterer runs: one clusterer per plane, kept across events.
+        std::vector<common::ProximityClusterer> plane_clusterers(3, clusterer);
+        for (bool parallel : {false, true})
+        {
+            seconds = timeRuns(events, iterations, [&](const auto& event) {
+                Clusters out;
+                common::ClusterViews(plane_clusterers, event, {0, 1, 2}, parallel, out);
+                return out.size();
+            }, n_clusters);
+            results.push_back({parallel ? "clusterer_all_planes_parallel" : "clusterer_all_planes", seconds, n_clusters});
+        }
+
+        std::ofstream file;
+        if (!args["output"].empty())
+            file.open(args["output"]);
+        std::ostream& out = args["output"].empty() ? std::cout : file;
+
+        out << "{\n  \"config\": {";
+        bool first = true;
+        for (const auto& [key, value] : args)
+        {
+            out << (first ? "" : ",") << "\n    \"" << key << "\": \"" << value << "\"";
+            first = false;
+        }
+        out << "\n  },\n  \"mismatched_events\": " << n_mismatched << ",\n  \"runs\": [";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            out << (i == 0 ? "" : ",") << "\n    {"
+                << "\"name\": \"" << results[i].name << "\", "
+                << "\"seconds_per_event\": " << results[i].seconds << ", "
+                << "\"clusters_per_event\": " << static_cast<double>(results[i].n_clusters) / events.size() << ", "
+                << "\"speedup\": " << results[0].seconds / results[i].seconds << "}";
+        }
+        out << "\n  ]\n}\n";
+
+        if (n_mismatched > 0)
+        {
+            std::cerr << "clustering_benchmark: " << n_mismatched << " events clustered differently from the reference" << std::endl;
+            return 2;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "clustering_benchmark: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#ifndef DEADWIREFIELD_H
+#define DEADWIREFIELD_H
+
+#include "larcore/Geometry/Geometry.h"
+
+#include "CommonFunctions/ChannelMask.h"
+
+#include "TVector3.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace common
+{
+    // Per-plane distance, in wires, from every wire to the nearest wire whose
+    // channel is flagged in a ChannelMask, together with the affine (y, z) ->
+    // wire coordinate of each plane. Asking whether a point is at least n
+    // wires from any dead wire on every plane is then one multiply-add, a
+    // rounding and a table load per plane, with no geometry lookups and no
+    // exceptions. Points that project outside a plane are treated as inactive.
+    // Rebuild whenever the mask changes.
+    class DeadWireField
+    {
+    public:
+        void build(const ChannelMask& mask)
+        {
+            art::ServiceHandle<geo::Geometry> geo;
+
+            _planes.clear();
+            for (const geo::PlaneID& plane : geo->IteratePlaneIDs())
+            {
+                PlaneField field;
+                field.offset = geo->WireCoordinate(0., 0., plane);
+                field.dy = geo->WireCoordinate(1., 0., plane) - field.offset;
+                field.dz = geo->WireCoordinate(0., 1., plane) - field.offset;
+
+                const int n_wires = static_cast<int>(geo->Nwires(plane));
+                field.distance.assign(n_wires, std::numeric_limits<int>::max());
+
+                // Two sweeps give the distance to the nearest dead wire on
+                // either side.
+                int last_dead = -1;
+                for (int wire = 0; wire < n_wires; ++wire)
+                {
+                    if (mask.bad(geo->PlaneWireToChannel(geo::WireID(plane, wire))))
+                        last_dead = wire;
+                    if (last_dead >= 0)
+                        field.distance[wire] = wire - last_dead;
+                }
+
+                last_dead = -1;
+                for (int wire = n_wires - 1; wire >= 0; --wire)
+                {
+                    if (field.distance[wire] == 0)
+                        last_dead = wire;
+                    if (last_dead >= 0)
+                        field.distance[wire] = std::min(field.distance[wire], last_dead - wire);
+                }
+
+                _planes.push_back(std::move(field));
+            }
+        }
+
+        // True if the wire nearest to (y, z) on every plane is more than
+        // region wires from a dead wire.
+        bool active(const double y, const double z, const int region) const
+        {
+            for (const PlaneField& field : _planes)
+            {
+                const long wire = std::lround(std::fma(field.dy, y, std::fma(field.dz, z, field.offset)));
+                if (wire < 0 || wire >= static_cast<long>(field.distance.size()))
+                    return false;
+                if (field.distance[wire] <= region)
+                    return false;
+            }
+
+            return true;
+        }
+
+        bool active(const TVector3& point, const int region) const { return this->active(point.Y(), point.Z(), region); }
+
+        // True if every point passes active(); stops at the first that fails.
+        bool allActive(const std::vector<TVector3>& points, const int region) const
+        {
+            return std::all_of(points.begin(), points.end(), [&](const TVector3& point) { return this->active(point, region); });
+        }
+
+    private:
+        struct PlaneField
+        {
+            double offset = 0.;
+            double dy = 0.;
+            double dz = 0.;
+            std::vector<int> distance;
+        };
+
+        std::vector<PlaneField> _planes;
+    };
+}
+
+#endif
@@ -0,0 +1,273 @@
+#ifndef DECAYTOPOLOGY_H
+#define DECAYTOPOLOGY_H
+
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include "CommonFunctions/ParticleTable.h"
+#include "CommonFunctions/TruthGraph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace common
+{
+    // One particle of a decay topology. Empty or negative fields are not
+    // checked. When daughters are given, the particle's daughters in the
+    // truth graph must match them one to one, in any order; otherwise its
+    // daughters are unconstrained. Particles of nodes marked signature are
+    // reported in DecayMatch::signature, in node order, and must also pass
+    // the thresholds the topology was added with, if any. Written in FHiCL as
+    //
+    //   { Pdg: [310] Process: "Decay" EndProcess: "Decay" NumberDaughters: 2
+    //     MinMomentum: 0.1 Signature: false Label: "kshort" Daughters: [ ... ] }
+    struct DecayNode
+    {
+        std::vector<int> pdg;
+        std::string process;
+        std::string end_process;
+        int n_daughters = -1;
+        double min_momentum = 0.;
+        bool signature = false;
+        std::string label;
+        std::vector<DecayNode> daughters;
+    };
+
+    DecayNode MakeDecayNode(const fhicl::ParameterSet& pset)
+    {
+        DecayNode node;
+        node.pdg = pset.get<std::vector<int>>("Pdg", {});
+        node.process = pset.get<std::string>("Process", "");
+        node.end_process = pset.get<std::string>("EndProcess", "");
+        node.n_daughters = pset.get<int>("NumberDaughters", -1);
+        node.min_momentum = pset.get<double>("MinMomentum", 0.);
+        node.signature = pset.get<bool>("Signature", false);
+        node.label = pset.get<std::string>("Label", "");
+        for (const auto& daughter_pset : pset.get<std::vector<fhicl::ParameterSet>>("Daughters", {}))
+            node.daughters.push_back(MakeDecayNode(daughter_pset));
+
+        return node;
+    }
+
+    struct DecayMatch
+    {
+        bool found = false;
+        art::Ptr<simb::MCParticle> root;
+        std::vector<art::Ptr<simb::MCParticle>> signature;
+        std::map<std::string, art::Ptr<simb::MCParticle>> labelled;
+    };
+
+    using DecayMatches = std::vector<DecayMatch>;
+
+    // Compiles any number of decay topologies into flat node arrays and a
+    // root-PDG index, then finds the first root (in product order) matching
+    // each topology with a single pass over the truth graph. Only the
+    // topologies whose root PDG fits a particle are tried on it, so the cost
+    // of one more topology is close to zero for events without its root.
+    class DecayTopologyMatcher
+    {
+    public:
+        size_t add(const DecayNode& root, std::optional<ParticleThresholds> thresholds = std::nullopt)
+        {
+            const size_t id = _topologies.size();
+            _topologies.emplace_back();
+
+            Topology& topology = _topologies.back();
+            topology.thresholds = std::move(thresholds);
+            topology.nodes.push_back(this->compileNode(root));
+            this->compileChildren(topology, root, 0);
+
+            if (root.pdg.empty())
+                _any_root.push_back(id);
+            for (int pdg : root.pdg)
+                _by_root_pdg[pdg].push_back(id);
+
+            return id;
+        }
+
+        size_t size() const { return _topologies.size(); }
+
+        DecayMatches match(const TruthGraph& graph) const
+        {
+            DecayMatches matches(_topologies.size());
+            size_t n_found = 0;
+
+            std::vector<art::Ptr<simb::MCParticle>> assignment;
+            for (const auto& particle : graph.particles())
+            {
+                if (n_found == _topologies.size())
+                    break;
+
+                auto tryTopology = [&](size_t id) {
+                    if (matches[id].found)
+                        return;
+
+                    const Topology& topology = _topologies[id];
+                    assignment.assign(topology.nodes.size(), art::Ptr<simb::MCParticle>());
+                    if (!this->matchNode(topology, 0, particle, graph, assignment))
+                        return;
+
+                    DecayMatch& match = matches[id];
+                    match.found = true;
+                    match.root = particle;
+                    for (size_t n = 0; n < topology.nodes.size(); ++n)
+                    {
+                        if (topology.nodes[n].signature)
+                            match.signature.push_back(assignment[n]);
+                        if (!topology.nodes[n].label.empty())
+                            match.labelled[topology.nodes[n].label] = assignment[n];
+                    }
+                    n_found += 1;
+                };
+
+                auto it = _by_root_pdg.find(particle->PdgCode());
+                if (it != _by_root_pdg.end())
+                {
+                    for (size_t id : it->second)
+                        tryTopology(id);
+                }
+                for (size_t id : _any_root)
+                    tryTopology(id);
+            }
+
+            return matches;
+        }
+
+    private:
+        struct Node
+        {
+            std::vector<int> pdg;
+            std::string process;
+            std::string end_process;
+            ProcessCode process_code = kProcessOther;
+            ProcessCode end_process_code = kProcessOther;
+            int n_daughters;
+            double min_momentum;
+            bool signature;
+            std::string label;
+            size_t first_child = 0;
+            size_t n_children = 0;
+        };
+
+        // Nodes in an order where the children of each node are contiguous.
+        struct Topology
+        {
+            std::vector<Node> nodes;
+            std::optional<ParticleThresholds> thresholds;
+        };
+
+        std::vector<Topology> _topologies;
+        std::unordered_map<int, std::vector<size_t>> _by_root_pdg;
+        std::vector<size_t> _any_root;
+
+        Node compileNode(const DecayNode& src) const
+        {
+            Node node;
+            node.pdg = src.pdg;
+            std::sort(node.pdg.begin(), node.pdg.end());
+            node.process = src.process;
+            node.end_process = src.end_process;
+            node.process_code = InternProcess(src.process);
+            node.end_process_code = InternProcess(src.end_process);
+            node.n_daughters = src.n_daughters;
+            node.min_momentum = src.min_momentum;
+            node.signature = src.signature;
+            node.label = src.label;
+            return node;
+        }
+
+        void compileChildren(Topology& topology, const DecayNode& src, size_t index) const
+        {
+            if (src.daughters.size() > 64)
+                throw cet::exception("DecayTopologyMatcher") << "A topology node has " << src.daughters.size() << " daughters, at most 64 are supported";
+
+            const size_t first_child = topology.nodes.size();
+            topology.nodes[index].first_child = first_child;
+            topology.nodes[index].n_children = src.daughters.size();
+
+            for (const auto& daughter : src.daughters)
+                topology.nodes.push_back(this->compileNode(daughter));
+            for (size_t k = 0; k < src.daughters.size(); ++k)
+                this->compileChildren(topology, src.daughters[k], first_child + k);
+        }
+
+        // Processes are compared as interned codes; only those that intern
+        // to kProcessOther or kProcessInelastic need the string itself.
+        static bool needsProcessString(ProcessCode code) { return code == kProcessOther || code == kProcessInelastic; }
+
+        bool matchLocal(const Topology& topology, const Node& node, const art::Ptr<simb::MCParticle>& particle, const TruthGraph& graph) const
+        {
+            const simb::MCParticle& mcp = *particle;
+            if (!node.pdg.empty() && !std::binary_search(node.pdg.begin(), node.pdg.end(), mcp.PdgCode()))
+                return false;
+            if (node.n_daughters >= 0 && mcp.NumberDaughters() != node.n_daughters)
+                return false;
+            if (node.min_momentum > 0. && !(mcp.P() > node.min_momentum))
+                return false;
+            if (node.signature && topology.thresholds && !topology.thresholds->passes(mcp))
+                return false;
+            if (!node.process.empty())
+            {
+                if (graph.process(particle) != node.process_code)
+                    return false;
+                if (needsProcessString(node.process_code) && mcp.Process() != node.process)
+                    return false;
+            }
+            if (!node.end_process.empty())
+            {
+                if (graph.endProcess(particle) != node.end_process_code)
+                    return false;
+                if (needsProcessString(node.end_process_code) && mcp.EndProcess() != node.end_process)
+                    return false;
+            }
+
+            return true;
+        }
+
+        bool matchNode(const Topology& topology, size_t index, const art::Ptr<simb::MCParticle>& particle, const TruthGraph& graph,
+                       std::vector<art::Ptr<simb::MCParticle>>& assignment) const
+        {
+            const Node& node = topology.nodes[index];
+            if (!this->matchLocal(topology, node, particle, graph))
+                return false;
+
+            assignment[index] = particle;
+            if (node.n_children == 0)
+                return true;
+
+            const MCParticleSpan daughters = graph.daughters(particle);
+            if (daughters.size() != node.n_children)
+                return false;
+
+            return this->assignChildren(topology, node, 0, 0, daughters, graph, assignment);
+        }
+
+        // Backtracking search for a one-to-one assignment of the daughters to
+        // the child nodes; child k takes any daughter not yet used.
+        bool assignChildren(const Topology& topology, const Node& node, size_t k, uint64_t used, const MCParticleSpan& daughters,
+                            const TruthGraph& graph, std::vector<art::Ptr<simb::MCParticle>>& assignment) const
+        {
+            if (k == node.n_children)
+                return true;
+
+            for (size_t d = 0; d < daughters.size(); ++d)
+            {
+                if (used & (uint64_t(1) << d))
+                    continue;
+
+                if (this->matchNode(topology, node.first_child + k, daughters[d], graph, assignment) &&
+                    this->assignChildren(topology, node, k + 1, used | (uint64_t(1) << d), daughters, graph, assignment))
+                    return true;
+            }
+
+            return false;
+        }
+    };
+}
+
+#endif
@@ -3,6 +3,8 @@
 
 #include "larpandora/LArPandoraInterface/LArPandoraHelper.h"
 
+#include "CommonFunctions/PfpHierarchy.h"
+
 namespace common
 {
     lar_pandora::PFParticleVector GetDaughters(const art::Ptr<recob::PFParticle> &particle, const lar_pandora::PFParticleMap &pfParticleMap)
@@ -34,6 +36,22 @@ namespace common
             
         return nDescendents;
     }
+
+    /// As above, for the particle at index in a hierarchy built once per event
+    /// from pfParticles.
+    void GetDownstreamParticles(size_t index, const lar_pandora::PFParticleVector &pfParticles, const PfpHierarchy &hierarchy, lar_pandora::PFParticleVector &downstreamParticles)
+    {
+        std::vector<size_t> downstream;
+        hierarchy.downstream(index, downstream);
+        for (size_t i : downstream)
+            downstreamParticles.push_back(pfParticles.at(i));
+    }
+
+    unsigned int GetNDescendents(const art::Ptr<recob::PFParticle> &particle, const PfpHierarchy &hierarchy)
+    {
+        const long index = hierarchy.index(particle->Self());
+        return index < 0 ? 0u : hierarchy.nDescendents(index);
+    }
 } 
 
 #endif
\ No newline at end of file
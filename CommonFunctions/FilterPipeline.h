@@ -0,0 +1,157 @@
+#ifndef FILTERPIPELINE_H
+#define FILTERPIPELINE_H
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace common
+{
+    // An event product that is only read from the event the first time it is
+    // asked for. The factory returns null when the product is unavailable.
+    template <typename T>
+    class LazyProduct
+    {
+    public:
+        using Factory = std::function<std::unique_ptr<T>()>;
+
+        explicit LazyProduct(Factory factory) : _factory{std::move(factory)} {}
+
+        T* get()
+        {
+            if (!_fetched)
+            {
+                _value = _factory();
+                _fetched = true;
+            }
+
+            return _value.get();
+        }
+
+        bool fetched() const { return _fetched; }
+
+    private:
+        Factory _factory;
+        std::unique_ptr<T> _value;
+        bool _fetched = false;
+    };
+
+    struct FilterStageStats
+    {
+        std::string name;
+        size_t n_run = 0;
+        size_t n_rejected = 0;
+        double seconds = 0.;
+    };
+
+    // A sequence of event selection stages, each with an estimated cost of its
+    // own and a list of the event products it reads. order() arranges the
+    // stages so that at every step the stage with the smallest cost, counting
+    // the products that no earlier stage has already loaded, runs next; ties
+    // keep the order in which the stages were added. run() stops at the first
+    // stage that rejects the event, so products needed only by later stages
+    // are never read for it. Per-stage counts and timings are kept for the
+    // end-of-job report; run() may be called from several threads.
+    template <typename Context>
+    class FilterPipeline
+    {
+    public:
+        using Test = std::function<bool(Context&)>;
+
+        void addProduct(const std::string& name, double cost) { _product_cost[name] = cost; }
+
+        void addStage(const std::string& name, double cost, const std::vector<std::string>& products, Test test)
+        {
+            _stages.push_back({name, cost, products, std::move(test)});
+            _stats.push_back({name});
+        }
+
+        void order()
+        {
+            std::vector<Stage> ordered;
+            std::vector<FilterStageStats> ordered_stats;
+            std::set<std::string> loaded;
+
+            while (!_stages.empty())
+            {
+                size_t best = 0;
+                double best_cost = 0.;
+                for (size_t i = 0; i < _stages.size(); ++i)
+                {
+                    double cost = _stages[i].cost;
+                    for (const auto& product : _stages[i].products)
+                    {
+                        if (!loaded.count(product))
+                            cost += _product_cost[product];
+                    }
+
+                    if (i == 0 || cost < best_cost)
+                    {
+                        best = i;
+                        best_cost = cost;
+                    }
+                }
+
+                loaded.insert(_stages[best].products.begin(), _stages[best].products.end());
+                ordered.push_back(std::move(_stages[best]));
+                ordered_stats.push_back(std::move(_stats[best]));
+                _stages.erase(_stages.begin() + best);
+                _stats.erase(_stats.begin() + best);
+            }
+
+            _stages = std::move(ordered);
+            _stats = std::move(ordered_stats);
+        }
+
+        bool run(Context& context)
+        {
+            for (size_t i = 0; i < _stages.size(); ++i)
+            {
+                auto start = std::chrono::steady_clock::now();
+                bool pass = _stages[i].test(context);
+                auto finish = std::chrono::steady_clock::now();
+
+                {
+                    std::lock_guard<std::mutex> lock(_stats_mutex);
+                    _stats[i].n_run += 1;
+                    _stats[i].seconds += std::chrono::duration<double>(finish - start).count();
+                    if (!pass)
+                        _stats[i].n_rejected += 1;
+                }
+
+                if (!pass)
+                    return false;
+            }
+
+            return true;
+        }
+
+        std::vector<FilterStageStats> stats() const
+        {
+            std::lock_guard<std::mutex> lock(_stats_mutex);
+            return _stats;
+        }
+
+    private:
+        struct Stage
+        {
+            std::string name;
+            double cost;
+            std::vector<std::string> products;
+            Test test;
+        };
+
+        std::vector<Stage> _stages;
+        std::map<std::string, double> _product_cost;
+        std::vector<FilterStageStats> _stats;
+        mutable std::mutex _stats_mutex;
+    };
+}
+
+#endif
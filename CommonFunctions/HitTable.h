@@ -0,0 +1,85 @@
+#ifndef HITTABLE_H
+#define HITTABLE_H
+
+#include "art/Framework/Principal/Event.h"
+#include "lardataobj/RecoBase/Hit.h"
+#include "larreco/Calorimetry/CalorimetryAlg.h"
+
+#include "CommonFunctions/Pandora.h"
+#include "CommonFunctions/ChannelMask.h"
+
+#include <vector>
+
+namespace common
+{
+    // Structure-of-arrays view of an event's hits, filled once per event so
+    // that the Pandora view, position and calibrated charge of a hit are not
+    // recomputed by every stage that touches it. Rows are addressed by index;
+    // key maps a row back to its art::Ptr<recob::Hit>. Hits on wires outside
+    // their plane are left out.
+    struct HitTable
+    {
+        std::vector<PandoraView> view;
+        std::vector<float> drift;
+        std::vector<float> wire;
+        std::vector<float> charge;
+        std::vector<raw::ChannelID_t> channel;
+        std::vector<size_t> key;
+        std::vector<unsigned char> bad_channel;
+
+        size_t size() const { return key.size(); }
+
+        void clear()
+        {
+            view.clear();
+            drift.clear();
+            wire.clear();
+            charge.clear();
+            channel.clear();
+            key.clear();
+            bad_channel.clear();
+        }
+
+        void reserve(size_t n)
+        {
+            view.reserve(n);
+            drift.reserve(n);
+            wire.reserve(n);
+            charge.reserve(n);
+            channel.reserve(n);
+            key.reserve(n);
+            bad_channel.reserve(n);
+        }
+    };
+
+    void BuildHitTable(const art::Event &e, const std::vector<art::Ptr<recob::Hit>> &hits, const calo::CalorimetryAlg &calo_alg,
+                       const ChannelMask &bad_channel_mask, HitTable &table)
+    {
+        const PandoraGeometryLUT& lut = PandoraGeometryLUT::Instance();
+
+        table.clear();
+        table.reserve(hits.size());
+
+        for (const auto &hit : hits)
+        {
+            const geo::WireID hit_wire(hit->WireID());
+            if (hit_wire.Wire >= lut.nWires(hit_wire))
+                continue;
+
+            const PandoraView view = GetPandoraView(hit);
+            const TVector3 pos = GetPandoraHitPosition(e, hit, view);
+            const raw::ChannelID_t channel = hit->Channel();
+
+            table.view.push_back(view);
+            table.drift.push_back(pos.X());
+            table.wire.push_back(pos.Z());
+            table.charge.push_back(calo_alg.ElectronsFromADCArea(hit->Integral(), hit->WireID().Plane));
+            table.channel.push_back(channel);
+            table.key.push_back(hit.key());
+        }
+
+        bad_channel_mask.flag(table.channel, table.bad_channel);
+    }
+}
+
+#endif
\ No newline at end of file
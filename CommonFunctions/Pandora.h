@@ -8,25 +8,172 @@
 
 #include "larcore/Geometry/Geometry.h"
 #include "lardata/Utilities/GeometryUtilities.h"
+#include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+
+#include "CommonFunctions/PandoraView.h"
+
+#include <vector>
 
 namespace common
 {
-    enum PandoraView {TPC_VIEW_U, TPC_VIEW_V, TPC_VIEW_W};
+    float YZtoU(const float y_coord, const float z_coord);
+    float YZtoV(const float y_coord, const float z_coord);
+    float YZtoW(const float y_coord, const float z_coord);
+
+    // Channel-indexed Pandora view and projected wire coordinate, plus the
+    // linear tick -> x coefficients of every plane, so that placing a hit is
+    // two table loads and one multiply-add. The geometry part is filled on
+    // first use; the drift coefficients depend on the detector properties of
+    // the current run and are refreshed by updateDrift(). Where a channel
+    // reads out more than one wire the first wire is used; the wire centres
+    // of every plane are kept as well so that other wires, and hits placed in
+    // a view other than their channel's, are served without the geometry
+    // service. Modules build the table in beginJob and refresh it in beginRun
+    // so that event code never touches a legacy service.
+    class PandoraGeometryLUT
+    {
+    public:
+        static PandoraGeometryLUT& Instance()
+        {
+            static PandoraGeometryLUT lut;
+            return lut;
+        }
+
+        void updateDrift()
+        {
+            auto const* det = lar::providerFrom<detinfo::DetectorPropertiesService>();
+
+            for (size_t i = 0; i < _planes.size(); ++i)
+            {
+                const geo::PlaneID& plane = _planes[i];
+                const double x0 = det->ConvertTicksToX(0., plane.Plane, plane.TPC, plane.Cryostat);
+                const double x1 = det->ConvertTicksToX(1., plane.Plane, plane.TPC, plane.Cryostat);
+                _drift_slope[i] = x1 - x0;
+                _drift_offset[i] = x0;
+            }
+        }
+
+        bool contains(const raw::ChannelID_t channel) const { return channel < _plane_slot.size() && _plane_slot[channel] >= 0; }
+
+        PandoraView view(const raw::ChannelID_t channel) const
+        {
+            if (!this->contains(channel))
+                throw cet::exception("PandoraGeometryLUT") << "channel " << channel << " not in geometry";
+
+            return static_cast<PandoraView>(_view[channel]);
+        }
+
+        float wireCoordinate(const raw::ChannelID_t channel) const { return _wire_coordinate[channel]; }
+
+        PandoraView planeView(const geo::PlaneID& plane) const
+        {
+            const int slot = this->planeSlot(plane);
+            if (slot < 0 || _plane_view[slot] < 0)
+                throw cet::exception("PandoraGeometryLUT") << "plane " << plane.toString() << " has no Pandora view";
+
+            return static_cast<PandoraView>(_plane_view[slot]);
+        }
+
+        unsigned int nWires(const geo::PlaneID& plane) const
+        {
+            const int slot = this->planeSlot(plane);
+            return slot >= 0 ? _wire_centres[slot].size() : 0;
+        }
+
+        TVector3 position(const geo::WireID& wire_id, const float ticks, const PandoraView pandora_view) const
+        {
+            const int slot = this->planeSlot(wire_id);
+            if (slot < 0 || wire_id.Wire >= _wire_centres[slot].size())
+                throw cet::exception("PandoraGeometryLUT") << "wire " << wire_id.toString() << " not in geometry";
+
+            const std::pair<float, float>& yz = _wire_centres[slot][wire_id.Wire];
+            const float x_coord = std::fma(_drift_slope[slot], ticks, _drift_offset[slot]);
+
+            return TVector3(x_coord, 0.f, pandora_view == TPC_VIEW_U ? YZtoU(yz.first, yz.second) : pandora_view == TPC_VIEW_V ? YZtoV(yz.first, yz.second) : YZtoW(yz.first, yz.second));
+        }
+
+        float driftCoordinate(const raw::ChannelID_t channel, const float ticks) const
+        {
+            const int slot = _plane_slot[channel];
+            return std::fma(_drift_slope[slot], ticks, _drift_offset[slot]);
+        }
+
+    private:
+        std::vector<signed char> _view;
+        std::vector<float> _wire_coordinate;
+        std::vector<int> _plane_slot;
+        std::vector<geo::PlaneID> _planes;
+        std::vector<float> _drift_slope;
+        std::vector<float> _drift_offset;
+        std::vector<signed char> _plane_view;
+        std::vector<std::vector<std::pair<float, float>>> _wire_centres;
+
+        int planeSlot(const geo::PlaneID& plane) const
+        {
+            for (size_t i = 0; i < _planes.size(); ++i)
+            {
+                if (_planes[i] == plane)
+                    return static_cast<int>(i);
+            }
+
+            return -1;
+        }
+
+        PandoraGeometryLUT()
+        {
+            art::ServiceHandle<geo::Geometry> geo;
+
+            const size_t n_channels = geo->Nchannels();
+            _view.assign(n_channels, -1);
+            _wire_coordinate.assign(n_channels, 0.f);
+            _plane_slot.assign(n_channels, -1);
+
+            for (const geo::PlaneID& plane : geo->IteratePlaneIDs())
+            {
+                const int slot = static_cast<int>(_planes.size());
+                _planes.push_back(plane);
+                _wire_centres.emplace_back();
+                _wire_centres.back().reserve(geo->Nwires(plane));
+
+                const geo::View_t global_view(lar_pandora::LArPandoraGeometry::GetGlobalView(plane.Cryostat, plane.TPC, geo->View(plane)));
+                signed char pandora_view = -1;
+                if (global_view == geo::kW || global_view == geo::kY)
+                    pandora_view = TPC_VIEW_W;
+                else if (global_view == geo::kU)
+                    pandora_view = TPC_VIEW_U;
+                else if (global_view == geo::kV)
+                    pandora_view = TPC_VIEW_V;
+                _plane_view.push_back(pandora_view);
+
+                for (unsigned int wire = 0; wire < geo->Nwires(plane); ++wire)
+                {
+                    const geo::WireID wire_id(plane, wire);
+                    const TVector3 xyz = geo->Wire(wire_id).GetCenter();
+                    _wire_centres.back().emplace_back(xyz.Y(), xyz.Z());
+
+                    const raw::ChannelID_t channel = geo->PlaneWireToChannel(wire_id);
+                    if (channel >= n_channels || _plane_slot[channel] >= 0)
+                        continue;
+
+                    _view[channel] = pandora_view;
+                    _wire_coordinate[channel] = pandora_view == TPC_VIEW_U ? YZtoU(xyz.Y(), xyz.Z()) : pandora_view == TPC_VIEW_V ? YZtoV(xyz.Y(), xyz.Z()) : YZtoW(xyz.Y(), xyz.Z());
+                    _plane_slot[channel] = pandora_view >= 0 ? slot : -1;
+                }
+            }
+
+            _drift_slope.assign(_planes.size(), 0.f);
+            _drift_offset.assign(_planes.size(), 0.f);
+            this->updateDrift();
+        }
+    };
 
     PandoraView GetPandoraView(const art::Ptr<recob::Hit> &hit)
     {
-        const geo::WireID hit_wire(hit->WireID());
-        const geo::View_t hit_view(hit->View());
-        const geo::View_t pandora_view(lar_pandora::LArPandoraGeometry::GetGlobalView(hit_wire.Cryostat, hit_wire.TPC, hit_view));
-
-        if (pandora_view == geo::kW || pandora_view == geo::kY)
-            return TPC_VIEW_W;
-        else if (pandora_view == geo::kU)
-            return TPC_VIEW_U;
-        else if (pandora_view == geo::kV)
-            return TPC_VIEW_V;
-        else
-            throw cet::exception("PandoraFuncs") << "wire view not recognised";
+        const PandoraGeometryLUT& lut = PandoraGeometryLUT::Instance();
+        if (lut.contains(hit->Channel()))
+            return lut.view(hit->Channel());
+
+        return lut.planeView(hit->WireID());
     }
 
     float YZtoU(const float y_coord, const float z_coord)
@@ -58,16 +205,11 @@ namespace common
 
     TVector3 GetPandoraHitPosition(const art::Event &e, const art::Ptr<recob::Hit> hit, const PandoraView pandora_view)
     {
-        art::ServiceHandle<geo::Geometry> geo;
-        auto const* det = lar::providerFrom<detinfo::DetectorPropertiesService>();
-
-        const geo::WireID hit_wire(hit->WireID());
-        const double hit_time(hit->PeakTime());
-
-        const double x_coord = det->ConvertTicksToX(hit_time, hit_wire.Plane, hit_wire.TPC, hit_wire.Cryostat);
-        TVector3 xyz = geo->Cryostat(hit_wire.Cryostat).TPC(hit_wire.TPC).Plane(hit_wire.Plane).Wire(hit_wire.Wire).GetCenter();
+        const PandoraGeometryLUT& lut = PandoraGeometryLUT::Instance();
+        if (lut.contains(hit->Channel()) && lut.view(hit->Channel()) == pandora_view)
+            return TVector3(lut.driftCoordinate(hit->Channel(), hit->PeakTime()), 0.f, lut.wireCoordinate(hit->Channel()));
 
-        return TVector3(x_coord, 0.f, pandora_view == TPC_VIEW_U ? YZtoU(xyz.Y(), xyz.Z()) : pandora_view == TPC_VIEW_V ? YZtoV(xyz.Y(), xyz.Z()) : YZtoW(xyz.Y(), xyz.Z()));
+        return lut.position(hit->WireID(), hit->PeakTime(), pandora_view);
     }
 } 
 
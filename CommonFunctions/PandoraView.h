@@ -0,0 +1,9 @@
+#ifndef PANDORAVIEW_H
+#define PANDORAVIEW_H
+
+namespace common
+{
+    enum PandoraView {TPC_VIEW_U, TPC_VIEW_V, TPC_VIEW_W};
+}
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef PARTICLETABLE_H
+#define PARTICLETABLE_H
+
+#include "fhiclcpp/ParameterSet.h"
+#include "nusimdata/SimulationBase/MCParticle.h"
+
+#include "TDatabasePDG.h"
+
+#include <array>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace common
+{
+    // Geant4 creator/end processes the selection looks at. Every other
+    // process interns to kProcessOther; inelastic processes other than the
+    // charged-pion ones intern to kProcessInelastic.
+    enum ProcessCode : unsigned char
+    {
+        kProcessOther,
+        kProcessPrimary,
+        kProcessDecay,
+        kProcessHadElastic,
+        kProcessHIoni,
+        kProcessFastScintillation,
+        kProcessPiPlusInelastic,
+        kProcessPiMinusInelastic,
+        kProcessInelastic
+    };
+
+    ProcessCode InternProcess(const std::string& process)
+    {
+        if (process == "primary") return kProcessPrimary;
+        if (process == "Decay") return kProcessDecay;
+        if (process == "hadElastic") return kProcessHadElastic;
+        if (process == "hIoni") return kProcessHIoni;
+        if (process == "FastScintillation") return kProcessFastScintillation;
+        if (process == "pi+Inelastic") return kProcessPiPlusInelastic;
+        if (process == "pi-Inelastic") return kProcessPiMinusInelastic;
+        if (process.find("Inelastic") != std::string::npos) return kProcessInelastic;
+        return kProcessOther;
+    }
+
+    constexpr bool IsInelastic(const ProcessCode code)
+    {
+        return code == kProcessPiPlusInelastic || code == kProcessPiMinusInelastic || code == kProcessInelastic;
+    }
+
+    constexpr float kNoThreshold = std::numeric_limits<float>::infinity();
+
+    // Charge (for the positive PDG code), mass in GeV and default momentum
+    // threshold in GeV of the species the selection uses. Charged species
+    // without a threshold never pass; neutral species always do.
+    struct ParticleProperties
+    {
+        int pdg;
+        int charge;
+        float mass;
+        float threshold;
+    };
+
+    constexpr std::array<ParticleProperties, 21> kParticleTable = {{
+        {11, -1, 0.000511f, 0.1f},          // e
+        {12, 0, 0.f, 0.f},                  // nu_e
+        {13, -1, 0.105658f, 0.1f},          // mu
+        {14, 0, 0.f, 0.f},                  // nu_mu
+        {16, 0, 0.f, 0.f},                  // nu_tau
+        {22, 0, 0.f, 0.f},                  // gamma
+        {111, 0, 0.134977f, 0.f},           // pi0
+        {130, 0, 0.497611f, 0.f},           // K0L
+        {211, 1, 0.139570f, 0.1f},          // pi
+        {310, 0, 0.497611f, 0.f},           // K0S
+        {311, 0, 0.497611f, 0.f},           // K0
+        {321, 1, 0.493677f, 0.1f},          // K
+        {2112, 0, 0.939565f, 0.f},          // n
+        {2212, 1, 0.938272f, 0.1f},         // p
+        {3112, -1, 1.197449f, 0.1f},        // sigma-
+        {3122, 0, 1.115683f, 0.f},          // lambda
+        {3212, 0, 1.192642f, 0.f},          // sigma0
+        {3222, 1, 1.189370f, 0.1f},         // sigma+
+        {3312, -1, 1.32171f, kNoThreshold}, // xi-
+        {3322, 0, 1.31486f, 0.f},           // xi0
+        {3334, -1, 1.67245f, kNoThreshold}, // omega-
+    }};
+
+    // Index of |pdg| in kParticleTable, or -1.
+    constexpr int ParticleIndex(const int pdg)
+    {
+        const int abs_pdg = pdg < 0 ? -pdg : pdg;
+        for (size_t i = 0; i < kParticleTable.size(); ++i)
+        {
+            if (kParticleTable[i].pdg == abs_pdg)
+                return static_cast<int>(i);
+        }
+
+        return -1;
+    }
+
+    // Charge of a tabulated species, sign-flipped for antiparticles; 0 for
+    // species not in the table.
+    constexpr int ParticleCharge(const int pdg)
+    {
+        const int i = ParticleIndex(pdg);
+        if (i < 0)
+            return 0;
+
+        return pdg < 0 ? -kParticleTable[i].charge : kParticleTable[i].charge;
+    }
+
+    // Whether a species not in kParticleTable is neutral, looked up in
+    // TDatabasePDG once per PDG code and cached for the job. Species unknown
+    // to TDatabasePDG, such as most nuclei, count as charged.
+    inline bool IsUntabulatedNeutral(const int pdg)
+    {
+        static std::mutex mutex;
+        static std::unordered_map<int, bool> neutral;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = neutral.find(pdg);
+        if (it == neutral.end())
+        {
+            const TParticlePDG* particle = TDatabasePDG::Instance()->GetParticle(pdg);
+            it = neutral.emplace(pdg, particle != nullptr && particle->Charge() == 0.).first;
+        }
+
+        return it->second;
+    }
+
+    // Per-job momentum thresholds: the table defaults, overridden by the
+    // *Threshold parameters of the Thresholds FHiCL table where present.
+    class ParticleThresholds
+    {
+    public:
+        ParticleThresholds()
+        {
+            for (size_t i = 0; i < kParticleTable.size(); ++i)
+                _threshold[i] = kParticleTable[i].threshold;
+        }
+
+        void configure(const fhicl::ParameterSet& pset)
+        {
+            static const std::array<std::pair<const char*, int>, 9> names = {{
+                {"ElectronThreshold", 11}, {"MuonThreshold", 13}, {"PionThreshold", 211},
+                {"KaonThreshold", 321}, {"ProtonThreshold", 2212}, {"SigmaMinusThreshold", 3112},
+                {"SigmaPlusThreshold", 3222}, {"XiMinusThreshold", 3312}, {"OmegaMinusThreshold", 3334}
+            }};
+
+            for (const auto& [name, pdg] : names)
+            {
+                if (pset.has_key(name))
+                    _threshold[ParticleIndex(pdg)] = pset.get<float>(name);
+            }
+        }
+
+        // Neutral species always pass, whether tabulated or not; charged ones
+        // need momentum above their threshold, and untabulated charged
+        // species never pass.
+        bool passes(const simb::MCParticle& mcp) const
+        {
+            const int i = ParticleIndex(mcp.PdgCode());
+            if (i < 0)
+                return IsUntabulatedNeutral(mcp.PdgCode());
+            if (kParticleTable[i].charge == 0)
+                return true;
+
+            return mcp.P() > _threshold[i];
+        }
+
+    private:
+        std::array<float, kParticleTable.size()> _threshold;
+    };
+}
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef PFPHIERARCHY_H
+#define PFPHIERARCHY_H
+
+#include "cetlib_except/exception.h"
+
+#include "CommonFunctions/Span.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace common
+{
+    // The PFParticle hierarchy of an event, built once: each particle's
+    // Self() -> position in the collection as one hash, and every particle's
+    // daughters as compressed sparse rows of positions, so that walking a
+    // slice touches each of its particles once. Daughters keep the order of
+    // PFParticle::Daughters(); those not in the collection are skipped.
+    class PfpHierarchy
+    {
+    public:
+        // Accepts any collection whose elements give the PFParticle through
+        // operator-> (a PFParticle proxy collection, a vector of art::Ptr).
+        template <typename PfpCollection>
+        explicit PfpHierarchy(const PfpCollection& pfps)
+        {
+            for (const auto& pfp : pfps)
+            {
+                if (!_index.emplace(pfp->Self(), _child_offset.size()).second)
+                    throw cet::exception("PfpHierarchy") << "Found repeated PFParticle with Self = " << pfp->Self();
+                _child_offset.push_back(0);
+            }
+
+            const size_t n = _child_offset.size();
+            _child_offset.assign(n + 1, 0);
+
+            size_t i = 0;
+            for (const auto& pfp : pfps)
+            {
+                for (const auto daughter_id : pfp->Daughters())
+                {
+                    auto it = _index.find(daughter_id);
+                    if (it != _index.end())
+                        _children.push_back(it->second);
+                }
+
+                _child_offset[++i] = _children.size();
+            }
+        }
+
+        size_t size() const { return _child_offset.size() - 1; }
+
+        // Position of the PFParticle with this Self(), or -1.
+        long index(size_t self) const
+        {
+            auto it = _index.find(self);
+            return it != _index.end() ? static_cast<long>(it->second) : -1;
+        }
+
+        Span<size_t> children(size_t i) const
+        {
+            return Span<size_t>(_children.data() + _child_offset[i], _children.data() + _child_offset[i + 1]);
+        }
+
+        // Positions of i and everything below it, depth first with each
+        // particle before its daughters, as the recursive traversals did.
+        void downstream(size_t i, std::vector<size_t>& out) const
+        {
+            std::vector<size_t> stack(1, i);
+            while (!stack.empty())
+            {
+                const size_t k = stack.back();
+                stack.pop_back();
+                out.push_back(k);
+
+                const Span<size_t> daughters = this->children(k);
+                for (size_t d = daughters.size(); d > 0; --d)
+                    stack.push_back(daughters[d - 1]);
+            }
+        }
+
+        size_t nDescendents(size_t i) const
+        {
+            size_t n = 0;
+            std::vector<size_t> stack(1, i);
+            while (!stack.empty())
+            {
+                const size_t k = stack.back();
+                stack.pop_back();
+
+                const Span<size_t> daughters = this->children(k);
+                n += daughters.size();
+                stack.insert(stack.end(), daughters.begin(), daughters.end());
+            }
+
+            return n;
+        }
+
+    private:
+        std::unordered_map<size_t, size_t> _index;
+        std::vector<size_t> _child_offset;
+        std::vector<size_t> _children;
+    };
+}
+
+#endif
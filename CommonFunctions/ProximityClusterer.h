@@ -0,0 +1,397 @@
+#ifndef PROXIMITYCLUSTERER_H
+#define PROXIMITYCLUSTERER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace common
+{
+    // The fields of a recob::Hit that proximity clustering reads, copied
+    // into one contiguous array so the pair tests do not chase art::Ptrs.
+    struct ClusterHit
+    {
+        int view;
+        unsigned int plane;
+        unsigned int wire;
+        unsigned int channel;
+        float peak_time;
+        float rms;
+    };
+
+    bool TimeOverlap(const ClusterHit& h1, const ClusterHit& h2, const float& _time2cm, double& dmin)
+    {
+        auto T1 = h1.peak_time * _time2cm;
+        auto T2 = h2.peak_time * _time2cm;
+        auto W1 = h1.rms * _time2cm;
+        auto W2 = h2.rms * _time2cm;
+
+        double d = dmin;
+
+        if (T1 > T2) {
+            if ( (T2+W2) > (T1-W1) ) return true;
+
+            d = (T1-W1) - (T2+W2);
+            if (d < dmin) dmin = d;
+        }
+
+        else {
+            if ( (T1+W1) > (T2-W2) ) return true;
+
+            d = (T2-W2) - (T1+W1);
+            if (d < dmin) dmin = d;
+        }
+
+        return false;
+    }
+
+    bool HitsCompatible(const ClusterHit& h1, const ClusterHit& h2, const float& _time2cm, const float& _wire2cm, const float& _radius)
+    {
+        if (h1.plane != h2.plane)
+            return false;
+
+        double dt = ( h1.peak_time - h2.peak_time ) * _time2cm;
+
+        if (TimeOverlap(h1,h2,_time2cm,dt) == true)
+            dt = 0;
+
+        double dw = fabs(((double)h1.channel-(double)h2.channel)*_wire2cm);
+        if (dw >  0.3) dw -= 0.3;
+
+        double d = dt*dt + dw*dw;
+
+        if (d > (_radius*_radius))
+            return false;
+
+        return true;
+    }
+
+    // Proximity clustering of the hits of one view. Hits are binned in
+    // (wire, time) cells of side cell_size cm; each hit is tested against
+    // the hits of its own and the eight neighbouring cells, and compatible
+    // pairs end up in one cluster.
+    //
+    // The cells are a sorted flat array, clusters are merged by union-find
+    // over cluster labels with their hit lists spliced in constant time, and
+    // all buffers are kept between calls. Cells, neighbours and pairs are
+    // visited in the order of the original map-based implementation and the
+    // same assignment rules are applied, so the output - clusters ordered
+    // by creation, hits in insertion order - is identical to it. That
+    // includes its one quirk: HitsCompatible is not symmetric in time, so a
+    // hit taken into a cluster as a neighbour can later, finding no
+    // compatible neighbour of its own, also start a cluster of its own.
+    class ProximityClusterer
+    {
+    public:
+        ProximityClusterer(float cell_size, float radius, float wire2cm, float time2cm)
+            : _cell_size{cell_size}, _radius{radius}, _wire2cm{wire2cm}, _time2cm{time2cm}
+        {}
+
+        // Wire and tick to cm, for when the detector properties change.
+        void setConversions(float wire2cm, float time2cm)
+        {
+            _wire2cm = wire2cm;
+            _time2cm = time2cm;
+        }
+
+        // Appends the clusters of view's hits to out, as indices into hits.
+        void cluster(const std::vector<ClusterHit>& hits, int view, std::vector<std::vector<unsigned int>>& out)
+        {
+            this->makeCells(hits, view);
+            this->reset(hits.size());
+
+            for (size_t c = 0; c < _cells.size(); ++c)
+            {
+                this->gatherNeighbours(c);
+
+                for (uint32_t k = _cells[c].begin; k < _cells[c].end; ++k)
+                {
+                    const uint32_t hit1 = _cell_hits[k].hit;
+                    bool matched = false;
+                    for (uint32_t hit2 : _neighbours)
+                    {
+                        if (hit1 == hit2) continue;
+                        if (!HitsCompatible(hits[hit1], hits[hit2], _time2cm, _wire2cm, _radius))
+                            continue;
+
+                        matched = true;
+                        this->join(hit1, hit2);
+                    }
+
+                    if (!matched)
+                    {
+                        const uint32_t label = this->newLabel();
+                        if (_hit_label[hit1] >= 0)
+                        {
+                            this->addShared(this->find(_hit_label[hit1]), hit1);
+                            this->addShared(label, hit1);
+                        }
+                        this->append(label, hit1);
+                        _hit_label[hit1] = label;
+                    }
+                }
+            }
+
+            for (uint32_t label = 0; label < _parent.size(); ++label)
+            {
+                if (_parent[label] != label)
+                    continue;
+
+                std::vector<unsigned int> clus;
+                for (int32_t n = _head[label]; n >= 0; n = _node_next[n])
+                    clus.push_back(_node_hit[n]);
+                out.push_back(std::move(clus));
+            }
+        }
+
+    private:
+        struct CellHit
+        {
+            int i, j;
+            uint32_t hit;
+        };
+
+        struct Cell
+        {
+            int i, j;
+            uint32_t begin, end;
+        };
+
+        float _cell_size, _radius, _wire2cm, _time2cm;
+
+        std::vector<CellHit> _cell_hits;
+        std::vector<Cell> _cells;
+        std::vector<uint32_t> _neighbours;
+
+        // Per hit: its current cluster label (resolved through find), or -1.
+        std::vector<int32_t> _hit_label;
+
+        // Per label: union-find parent and the ends of its hit list; lists
+        // are chains through the node pool.
+        std::vector<uint32_t> _parent;
+        std::vector<int32_t> _head, _tail;
+        std::vector<uint32_t> _node_hit;
+        std::vector<int32_t> _node_next;
+
+        // Per label: hits listed both in this cluster and in another one,
+        // whose label must follow whichever of the two is merged last.
+        std::vector<int32_t> _shared_head, _shared_tail;
+        std::vector<uint32_t> _shared_hit;
+        std::vector<int32_t> _shared_next;
+
+        void makeCells(const std::vector<ClusterHit>& hits, int view)
+        {
+            _cell_hits.clear();
+            for (size_t h = 0; h < hits.size(); ++h)
+            {
+                if (hits[h].view != view)
+                    continue;
+
+                double t = hits[h].peak_time * _time2cm;
+                double w = hits[h].wire * _wire2cm;
+                _cell_hits.push_back({int(w / _cell_size), int(t / _cell_size), static_cast<uint32_t>(h)});
+            }
+
+            std::sort(_cell_hits.begin(), _cell_hits.end(), [](const CellHit& a, const CellHit& b) {
+                if (a.i != b.i) return a.i < b.i;
+                if (a.j != b.j) return a.j < b.j;
+                return a.hit < b.hit;
+            });
+
+            _cells.clear();
+            for (uint32_t k = 0; k < _cell_hits.size(); ++k)
+            {
+                if (_cells.empty() || _cells.back().i != _cell_hits[k].i || _cells.back().j != _cell_hits[k].j)
+                    _cells.push_back({_cell_hits[k].i, _cell_hits[k].j, k, k});
+                _cells.back().end = k + 1;
+            }
+        }
+
+        long findCell(int i, int j) const
+        {
+            auto it = std::lower_bound(_cells.begin(), _cells.end(), std::make_pair(i, j), [](const Cell& cell, const std::pair<int, int>& key) {
+                return cell.i != key.first ? cell.i < key.first : cell.j < key.second;
+            });
+
+            return (it != _cells.end() && it->i == i && it->j == j) ? static_cast<long>(it - _cells.begin()) : -1;
+        }
+
+        // Hits of the cell and its neighbours, in the original visiting order.
+        void gatherNeighbours(size_t c)
+        {
+            static const int offsets[9][2] = {{0, 0}, {-1, 0}, {0, -1}, {-1, -1}, {0, 1}, {1, 0}, {1, 1}, {-1, 1}, {1, -1}};
+
+            _neighbours.clear();
+            for (const auto& offset : offsets)
+            {
+                const long n = offset[0] == 0 && offset[1] == 0 ? static_cast<long>(c) : this->findCell(_cells[c].i + offset[0], _cells[c].j + offset[1]);
+                if (n < 0)
+                    continue;
+
+                for (uint32_t k = _cells[n].begin; k < _cells[n].end; ++k)
+                    _neighbours.push_back(_cell_hits[k].hit);
+            }
+        }
+
+        void reset(size_t n_hits)
+        {
+            _hit_label.assign(n_hits, -1);
+            _parent.clear();
+            _head.clear();
+            _tail.clear();
+            _node_hit.clear();
+            _node_next.clear();
+            _shared_head.clear();
+            _shared_tail.clear();
+            _shared_hit.clear();
+            _shared_next.clear();
+        }
+
+        uint32_t newLabel()
+        {
+            const uint32_t label = static_cast<uint32_t>(_parent.size());
+            _parent.push_back(label);
+            _head.push_back(-1);
+            _tail.push_back(-1);
+            _shared_head.push_back(-1);
+            _shared_tail.push_back(-1);
+            return label;
+        }
+
+        uint32_t find(uint32_t label)
+        {
+            while (_parent[label] != label)
+            {
+                _parent[label] = _parent[_parent[label]];
+                label = _parent[label];
+            }
+
+            return label;
+        }
+
+        static void splice(std::vector<int32_t>& head, std::vector<int32_t>& tail, std::vector<int32_t>& next, uint32_t to, uint32_t from)
+        {
+            if (head[from] < 0)
+                return;
+
+            if (head[to] < 0)
+                head[to] = head[from];
+            else
+                next[tail[to]] = head[from];
+            tail[to] = tail[from];
+            head[from] = tail[from] = -1;
+        }
+
+        void append(uint32_t label, uint32_t hit)
+        {
+            const int32_t node = static_cast<int32_t>(_node_hit.size());
+            _node_hit.push_back(hit);
+            _node_next.push_back(-1);
+
+            if (_head[label] < 0)
+                _head[label] = node;
+            else
+                _node_next[_tail[label]] = node;
+            _tail[label] = node;
+        }
+
+        void addShared(uint32_t label, uint32_t hit)
+        {
+            const int32_t node = static_cast<int32_t>(_shared_hit.size());
+            _shared_hit.push_back(hit);
+            _shared_next.push_back(-1);
+
+            if (_shared_head[label] < 0)
+                _shared_head[label] = node;
+            else
+                _shared_next[_shared_tail[label]] = node;
+            _shared_tail[label] = node;
+        }
+
+        void join(uint32_t hit1, uint32_t hit2)
+        {
+            const bool has1 = _hit_label[hit1] >= 0;
+            const bool has2 = _hit_label[hit2] >= 0;
+
+            if (has1 && has2)
+            {
+                const uint32_t idx1 = this->find(_hit_label[hit1]);
+                const uint32_t idx2 = this->find(_hit_label[hit2]);
+                if (idx1 == idx2)
+                    return;
+
+                // Every hit listed in idx2 now belongs to idx1; for hits
+                // listed only there that follows from the union, shared ones
+                // are relabelled explicitly.
+                for (int32_t n = _shared_head[idx2]; n >= 0; n = _shared_next[n])
+                    _hit_label[_shared_hit[n]] = idx1;
+
+                _parent[idx2] = idx1;
+                splice(_head, _tail, _node_next, idx1, idx2);
+                splice(_shared_head, _shared_tail, _shared_next, idx1, idx2);
+            }
+            else if (has2)
+            {
+                const uint32_t label = this->find(_hit_label[hit2]);
+                _hit_label[hit1] = label;
+                this->append(label, hit1);
+            }
+            else if (has1)
+            {
+                const uint32_t label = this->find(_hit_label[hit1]);
+                _hit_label[hit2] = label;
+                this->append(label, hit2);
+            }
+            else
+            {
+                const uint32_t label = this->newLabel();
+                _hit_label[hit1] = label;
+                _hit_label[hit2] = label;
+                this->append(label, hit1);
+                this->append(label, hit2);
+            }
+        }
+    };
+
+    // Clusters views[v] with clusterers[v], on one thread per view when
+    // parallel, and appends the clusters to out in the order of views.
+    void ClusterViews(std::vector<ProximityClusterer>& clusterers, const std::vector<ClusterHit>& hits, const std::vector<int>& views,
+                      bool parallel, std::vector<std::vector<unsigned int>>& out)
+    {
+        std::vector<std::vector<std::vector<unsigned int>>> view_clusters(views.size());
+        auto run = [&](size_t v) {
+            clusterers[v].cluster(hits, views[v], view_clusters[v]);
+        };
+
+        if (parallel && views.size() > 1)
+        {
+            std::vector<std::thread> threads;
+            for (size_t v = 0; v < views.size(); ++v)
+                threads.emplace_back(run, v);
+            for (auto& thread : threads)
+                thread.join();
+        }
+        else
+        {
+            for (size_t v = 0; v < views.size(); ++v)
+                run(v);
+        }
+
+        for (auto& clusters : view_clusters)
+        {
+            for (auto& clus : clusters)
+                out.push_back(std::move(clus));
+        }
+    }
+
+    void ClusterViews(const std::vector<ClusterHit>& hits, const std::vector<int>& views, float cell_size, float radius, float wire2cm, float time2cm,
+                      bool parallel, std::vector<std::vector<unsigned int>>& out)
+    {
+        std::vector<ProximityClusterer> clusterers(views.size(), ProximityClusterer(cell_size, radius, wire2cm, time2cm));
+        ClusterViews(clusterers, hits, views, parallel, out);
+    }
+}
+
+#endif
@@ -9,47 +9,45 @@
 #include "nusimdata/SimulationBase/MCParticle.h"
 #include "lardata/RecoBaseProxy/ProxyBase.h"
 #include "CommonFunctions/Types.h"
+#include "CommonFunctions/PfpHierarchy.h"
 
 namespace common
 {
+    /// Appends pfp_pxy and everything below it in the hierarchy to slice_v,
+    /// each particle before its daughters.
     void addDaughters(const ProxyPfpElem_t &pfp_pxy,
                                            const ProxyPfpColl_t &pfp_pxy_col,
+                                           const PfpHierarchy &hierarchy,
                                            std::vector<ProxyPfpElem_t> &slice_v)
     {
-        std::map<unsigned int, unsigned int> pfp_map;
+        const long root = hierarchy.index(pfp_pxy->Self());
+        if (root < 0)
+            return;
 
-        unsigned int p = 0;
-        for (const auto &pfp_pxy : pfp_pxy_col)
-        {
-            pfp_map[pfp_pxy->Self()] = p;
-            p++;
-        }
-    
-        auto daughters = pfp_pxy->Daughters();
-
-        slice_v.push_back(pfp_pxy);
+        std::vector<size_t> downstream;
+        hierarchy.downstream(root, downstream);
 
-        std::cout << "\t PFP w/ PdgCode " << pfp_pxy->PdgCode() << " has " << daughters.size() << " daughters" << std::endl;
-
-        for (auto const &daughterid : daughters)
+        for (size_t p : downstream)
         {
+            const ProxyPfpElem_t &pfp = pfp_pxy_col[p];
+            slice_v.push_back(pfp);
 
-            if (pfp_map.find(daughterid) == pfp_map.end())
-                continue;
-
-            auto pfp_pxy2 = pfp_pxy_col.begin();
-            for (size_t j = 0; j < pfp_map.at(daughterid); ++j)
-                ++pfp_pxy2;
-
-            common::addDaughters(*pfp_pxy2, pfp_pxy_col, slice_v);
-
-        } 
+            std::cout << "\t PFP w/ PdgCode " << pfp->PdgCode() << " has " << pfp->Daughters().size() << " daughters" << std::endl;
+        }
 
         return;
     } 
 
+    void addDaughters(const ProxyPfpElem_t &pfp_pxy,
+                                           const ProxyPfpColl_t &pfp_pxy_col,
+                                           std::vector<ProxyPfpElem_t> &slice_v)
+    {
+        addDaughters(pfp_pxy, pfp_pxy_col, PfpHierarchy(pfp_pxy_col), slice_v);
+    } 
+
     std::pair<std::vector<art::Ptr<recob::Hit>>, std::vector<ProxyPfpElem_t>> getNuSliceHits(const common::ProxyPfpColl_t& pfp_proxy, 
-                                                 const common::ProxyClusColl_t& clus_proxy)
+                                                 const common::ProxyClusColl_t& clus_proxy,
+                                                 const PfpHierarchy& hierarchy)
     {
         std::vector<art::Ptr<recob::Hit>> nu_slice_hits;
         std::vector<ProxyPfpElem_t> nu_slice;
@@ -62,7 +60,7 @@ namespace common
             if (pdg == 12 || pdg == 14) 
             {
                 nu_slice.clear();
-                common::addDaughters(pfp_pxy, pfp_proxy, nu_slice); 
+                common::addDaughters(pfp_pxy, pfp_proxy, hierarchy, nu_slice); 
                 break;  
             }
         }
@@ -83,6 +81,12 @@ namespace common
         return {nu_slice_hits, nu_slice};
     }
 
+    std::pair<std::vector<art::Ptr<recob::Hit>>, std::vector<ProxyPfpElem_t>> getNuSliceHits(const common::ProxyPfpColl_t& pfp_proxy, 
+                                                 const common::ProxyClusColl_t& clus_proxy)
+    {
+        return getNuSliceHits(pfp_proxy, clus_proxy, PfpHierarchy(pfp_proxy));
+    }
+
     void initialiseChargeMap(
         std::map<common::PandoraView, std::array<float, 2>>& q_centre_map,
         std::map<common::PandoraView, float>& tot_q_map)
@@ -4,6 +4,8 @@
 #include "larpandora/LArPandoraInterface/LArPandoraHelper.h"
 #include "larpandora/LArPandoraInterface/LArPandoraGeometry.h"
 
+#include "CommonFunctions/TruthGraph.h"
+
 namespace common
 {
     std::vector<art::Ptr<simb::MCParticle>> GetDaughters(const art::Ptr<simb::MCParticle> &particle, const std::map<int, art::Ptr<simb::MCParticle> > &mcParticleMap)
@@ -17,29 +19,26 @@ namespace common
         return daughters;
     }
 
-    void GetNScatters(const art::ValidHandle<std::vector<simb::MCParticle>> &mcp_h, const art::Ptr<simb::MCParticle> &mcParticle, art::Ptr<simb::MCParticle> &mcScatteredParticle, unsigned int &nElastic, unsigned int &nInelastic)
+    MCParticleSpan GetDaughters(const art::Ptr<simb::MCParticle> &particle, const TruthGraph &truthGraph)
     {
-        mcScatteredParticle = mcParticle;
+        return truthGraph.daughters(particle);
+    }
 
-        std::map<int, art::Ptr<simb::MCParticle> > mcParticleMap;
-        for (size_t d = 0; d < mcp_h->size(); d++)
-        {
-            const art::Ptr<simb::MCParticle> mcParticle(mcp_h, d);
-            if (!mcParticleMap.emplace(mcParticle->TrackId(), mcParticle).second)
-                throw cet::exception("::GetNScatters") << " - Found repeated MCParticle with TrackId = " << mcParticle->TrackId() << "." << std::endl;
-        }
+    void GetNScatters(const TruthGraph &truthGraph, const art::Ptr<simb::MCParticle> &mcParticle, art::Ptr<simb::MCParticle> &mcScatteredParticle, unsigned int &nElastic, unsigned int &nInelastic)
+    {
+        mcScatteredParticle = mcParticle;
 
         art::Ptr<simb::MCParticle> finalStateParticle;
         bool foundInelasticScatter = false;
-        for (const auto &daughter : GetDaughters(mcParticle, mcParticleMap))
+        for (const auto &daughter : GetDaughters(mcParticle, truthGraph))
         {
-            const auto& process = daughter->Process();
+            const ProcessCode process = truthGraph.process(daughter);
 
-            if (process == "hadElastic") 
+            if (process == kProcessHadElastic) 
             {
                 nElastic++;
             }
-            else if (process.find("Inelastic") != std::string::npos)
+            else if (IsInelastic(process))
             {
                 if (daughter->PdgCode() != mcParticle->PdgCode()) continue;
 
@@ -58,49 +57,47 @@ namespace common
         if (foundInelasticScatter)
         {
             nInelastic++;
-            GetNScatters(mcp_h, finalStateParticle, mcScatteredParticle, nElastic, nInelastic);
+            GetNScatters(truthGraph, finalStateParticle, mcScatteredParticle, nElastic, nInelastic);
         }
     }
 
-    std::string GetEndState(const art::Ptr<simb::MCParticle> &particle, const art::ValidHandle<std::vector<simb::MCParticle>> &mcp_h)
+    void GetNScatters(const art::ValidHandle<std::vector<simb::MCParticle>> &mcp_h, const art::Ptr<simb::MCParticle> &mcParticle, art::Ptr<simb::MCParticle> &mcScatteredParticle, unsigned int &nElastic, unsigned int &nInelastic)
+    {
+        GetNScatters(TruthGraph(mcp_h), mcParticle, mcScatteredParticle, nElastic, nInelastic);
+    }
+
+    std::string GetEndState(const art::Ptr<simb::MCParticle> &particle, const TruthGraph &truthGraph)
     {
         std::string type = "Other";
         bool hasPi0 = false;
         bool hasDecayMuon = false;
         bool hasDecayMuonNeutrino = false;
 
-        std::map<int, art::Ptr<simb::MCParticle>> mcParticleMap;
-        for (size_t d = 0; d < mcp_h->size(); d++)
-        {
-            const art::Ptr<simb::MCParticle> mcParticle(mcp_h, d);
-            mcParticleMap[mcParticle->TrackId()] = mcParticle;
-        }
-
         art::Ptr<simb::MCParticle> scatteredParticle = particle;
         unsigned int nElastic = 0;
         unsigned int nInelastic = 0;
-        GetNScatters(mcp_h, particle, scatteredParticle, nElastic, nInelastic);
+        GetNScatters(truthGraph, particle, scatteredParticle, nElastic, nInelastic);
 
         std::vector<art::Ptr<simb::MCParticle>> products;
-        for (const auto &daughter : GetDaughters(scatteredParticle, mcParticleMap))
+        for (const auto &daughter : GetDaughters(scatteredParticle, truthGraph))
         {
-            const auto process = daughter->Process();
+            const ProcessCode process = truthGraph.process(daughter);
 
-            if (daughter->PdgCode() == 11 && process == "hIoni")
+            if (daughter->PdgCode() == 11 && process == kProcessHIoni)
                 continue;
 
-            if (process == "hadElastic")
+            if (process == kProcessHadElastic)
                 continue;
 
             products.push_back(daughter);
 
-            if (daughter->PdgCode() == 111 && (process == "pi+Inelastic" || process == "pi-Inelastic"))
+            if (daughter->PdgCode() == 111 && (process == kProcessPiPlusInelastic || process == kProcessPiMinusInelastic))
                 hasPi0 = true;
 
-            if (daughter->PdgCode() == -13 && process == "Decay")
+            if (daughter->PdgCode() == -13 && process == kProcessDecay)
                 hasDecayMuon = true;
 
-            if (daughter->PdgCode() == 14 && process == "Decay")
+            if (daughter->PdgCode() == 14 && process == kProcessDecay)
                 hasDecayMuonNeutrino = true;
         }
 
@@ -112,7 +109,7 @@ namespace common
         {
             type = "DecayToMuon";
         }
-        else if (scatteredParticle->EndProcess() == "pi+Inelastic" || scatteredParticle->EndProcess() == "pi-Inelastic")
+        else if (truthGraph.endProcess(scatteredParticle) == kProcessPiPlusInelastic || truthGraph.endProcess(scatteredParticle) == kProcessPiMinusInelastic)
         {
             type = hasPi0 ? "Pi0ChargeExchange" : "InelasticAbsorption";
         }
@@ -124,6 +121,11 @@ namespace common
         return type;
     }
 
+    std::string GetEndState(const art::Ptr<simb::MCParticle> &particle, const art::ValidHandle<std::vector<simb::MCParticle>> &mcp_h)
+    {
+        return GetEndState(particle, TruthGraph(mcp_h));
+    }
+
     std::vector<art::Ptr<simb::MCParticle>> GetPionChain(const art::Ptr<simb::MCParticle> &particle, const std::map<int, art::Ptr<simb::MCParticle>> &mcParticleMap)
     {
         std::vector<art::Ptr<simb::MCParticle>> pion_chain;
@@ -0,0 +1,37 @@
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <cstddef>
+#include <stdexcept>
+
+namespace common
+{
+    // Read-only view of a contiguous run of elements owned elsewhere.
+    template <typename T>
+    class Span
+    {
+    public:
+        Span() = default;
+        Span(const T* first, const T* last) : _first{first}, _last{last} {}
+
+        const T* begin() const { return _first; }
+        const T* end() const { return _last; }
+        size_t size() const { return static_cast<size_t>(_last - _first); }
+        bool empty() const { return _first == _last; }
+
+        const T& operator[](size_t i) const { return _first[i]; }
+        const T& at(size_t i) const
+        {
+            if (i >= this->size())
+                throw std::out_of_range("common::Span::at");
+
+            return _first[i];
+        }
+
+    private:
+        const T* _first = nullptr;
+        const T* _last = nullptr;
+    };
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef TRUTHGRAPH_H
+#define TRUTHGRAPH_H
+
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Persistency/Common/Ptr.h"
+#include "cetlib_except/exception.h"
+#include "nusimdata/SimulationBase/MCParticle.h"
+
+#include "CommonFunctions/ParticleTable.h"
+#include "CommonFunctions/Span.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace common
+{
+    using MCParticleSpan = Span<art::Ptr<simb::MCParticle>>;
+
+    // The MCParticles of an event in product order, a TrackId -> index hash,
+    // and every particle's daughters as compressed sparse rows, so that a
+    // lookup is one hash probe and a daughter list is a slice of one array.
+    // Daughters keep the order of MCParticle::Daughter(i); those not stored
+    // in the product are skipped. Creator and end processes are interned to
+    // ProcessCode once, when the graph is built. As with the TrackId maps this
+    // replaces, a repeated TrackId resolves to the last particle carrying it.
+    class TruthGraph
+    {
+    public:
+        // Accepts an art::Handle or art::ValidHandle to the MCParticle product.
+        template <typename MCParticleHandle>
+        explicit TruthGraph(const MCParticleHandle& mcp_h)
+        {
+            const size_t n = mcp_h->size();
+            _particles.reserve(n);
+            _index.reserve(n);
+            _process.reserve(n);
+            _end_process.reserve(n);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                _particles.emplace_back(mcp_h, i);
+                const simb::MCParticle& mcp = *_particles.back();
+                _index[mcp.TrackId()] = i;
+
+                _process.push_back(InternProcess(mcp.Process()));
+                _end_process.push_back(InternProcess(mcp.EndProcess()));
+            }
+
+            _child_offset.assign(n + 1, 0);
+            for (size_t i = 0; i < n; ++i)
+            {
+                const simb::MCParticle& mcp = *_particles[i];
+                for (int d = 0; d < mcp.NumberDaughters(); ++d)
+                {
+                    auto it = _index.find(mcp.Daughter(d));
+                    if (it != _index.end())
+                        _children.push_back(_particles[it->second]);
+                }
+
+                _child_offset[i + 1] = _children.size();
+            }
+        }
+
+        size_t size() const { return _particles.size(); }
+        const std::vector<art::Ptr<simb::MCParticle>>& particles() const { return _particles; }
+
+        bool contains(int track_id) const { return _index.count(track_id) > 0; }
+
+        // Dense index of track_id, or -1 if it is not in the product.
+        long index(int track_id) const
+        {
+            auto it = _index.find(track_id);
+            return it != _index.end() ? static_cast<long>(it->second) : -1;
+        }
+
+        const art::Ptr<simb::MCParticle>& at(int track_id) const
+        {
+            const long i = this->index(track_id);
+            if (i < 0)
+                throw cet::exception("TruthGraph") << "No MCParticle with TrackId = " << track_id;
+
+            return _particles[i];
+        }
+
+        MCParticleSpan daughters(int track_id) const
+        {
+            const long i = this->index(track_id);
+            if (i < 0)
+                return MCParticleSpan();
+
+            return MCParticleSpan(_children.data() + _child_offset[i], _children.data() + _child_offset[i + 1]);
+        }
+
+        MCParticleSpan daughters(const art::Ptr<simb::MCParticle>& particle) const { return this->daughters(particle->TrackId()); }
+
+        // Interned processes by dense index, or by a Ptr into the same product.
+        ProcessCode process(size_t i) const { return _process[i]; }
+        ProcessCode endProcess(size_t i) const { return _end_process[i]; }
+        ProcessCode process(const art::Ptr<simb::MCParticle>& particle) const { return _process[particle.key()]; }
+        ProcessCode endProcess(const art::Ptr<simb::MCParticle>& particle) const { return _end_process[particle.key()]; }
+
+    private:
+        std::vector<art::Ptr<simb::MCParticle>> _particles;
+        std::unordered_map<int, size_t> _index;
+        std::vector<size_t> _child_offset;
+        std::vector<art::Ptr<simb::MCParticle>> _children;
+        std::vector<ProcessCode> _process;
+        std::vector<ProcessCode> _end_process;
+    };
+}
+
+#endif
@@ -17,8 +17,12 @@
 #include "SignatureTools/VertexToolBase.h"
 
 #include "TVector3.h"
+#include <array>
 #include <vector>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <algorithm>
 #include <string>
 
@@ -35,35 +39,44 @@
 
 namespace common
 {
-    void visualiseTrueEvent(const art::Event& e,
-                    const art::InputTag& mcp_producer,
-                    const art::InputTag& hit_producer,
-                    const art::InputTag& backtrack_tag,
-                    const std::string& filename)
+    // Compact copy of the truth-matched hits of an event, split by view:
+    // position, owning (lead electromagnetic) particle PDG code, and whether
+    // that particle belongs to the selected pattern. Enough to draw either
+    // event display without going back to the event.
+    struct ViewSnapshot
     {
-        auto getLimits = [](const std::vector<float>& wire_coords, const std::vector<float>& drift_coords,
-                    float& wire_min, float& wire_max, float& drift_min, float& drift_max)
-        {
-            if (!wire_coords.empty() && !drift_coords.empty()) {
-                wire_min = std::min(wire_min, *std::min_element(wire_coords.begin(), wire_coords.end()));
-                wire_max = std::max(wire_max, *std::max_element(wire_coords.begin(), wire_coords.end()));
-                drift_min = std::min(drift_min, *std::min_element(drift_coords.begin(), drift_coords.end()));
-                drift_max = std::max(drift_max, *std::max_element(drift_coords.begin(), drift_coords.end()));
+        std::vector<float> wire;
+        std::vector<float> drift;
+        std::vector<int> owner_pdg;
+        std::vector<unsigned char> in_signature;
 
-                if ((wire_max - wire_min) < 100.0f) {
-                    float padd = (100.0f - (wire_max - wire_min)) / 2.0f;
-                    wire_min -= padd;
-                    wire_max += padd;
-                }
+        size_t size() const { return wire.size(); }
+    };
 
-                if ((drift_max - drift_min) < 100.0f) {
-                    float padd = (100.0f - (drift_max - drift_min)) / 2.0f;
-                    drift_min -= padd;
-                    drift_max += padd;
-                }
-            }
-        };
+    struct EventSnapshot
+    {
+        std::string filename;
+        bool render_truth = false;
+        bool render_signature = false;
+        std::array<ViewSnapshot, 3> views;
+
+        size_t bytes() const
+        {
+            size_t n = 0;
+            for (const auto& view : views)
+                n += view.size() * (2 * sizeof(float) + sizeof(int) + sizeof(unsigned char));
+            return n;
+        }
+    };
 
+    void SnapshotEvent(const art::Event& e,
+                    const art::InputTag& mcp_producer,
+                    const art::InputTag& hit_producer,
+                    const art::InputTag& backtrack_tag,
+                    const signature::Pattern& patt,
+                    const std::string& filename,
+                    EventSnapshot& snapshot)
+    {
         art::Handle<std::vector<simb::MCParticle>> mc_particle_handle; 
         std::vector<art::Ptr<simb::MCParticle>> mc_particle_vector;
         lar_pandora::MCParticleMap mc_particle_map;
@@ -79,200 +92,178 @@ namespace common
         if (!e.getByLabel(hit_producer, evt_hits))
             throw cet::exception("Common") << "failed to find any hits in event" << std::endl;
         art::fill_ptr_vector(hit_vector, evt_hits);
-        art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData> assoc_mc_part = art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>(evt_hits, e, backtrack_tag);
+        art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData> assoc_mc_part(evt_hits, e, backtrack_tag);
 
-        std::map<int, int> hits_to_track_map;
-        std::map<int, std::vector<art::Ptr<recob::Hit>>> track_to_hits_map;
+        std::set<int> patt_track_ids;
+        for (const auto& signature : patt) {
+            for (const auto& mcp : signature)
+                patt_track_ids.insert(mcp->TrackId());
+        }
 
-        for (unsigned int i_h = 0; i_h < hit_vector.size(); i_h++)
+        snapshot.filename = filename;
+        for (auto& view : snapshot.views)
+            view = ViewSnapshot();
+
+        for (const art::Ptr<recob::Hit> &hit : hit_vector)
         {
-            const art::Ptr<recob::Hit> &hit = hit_vector[i_h];
             const std::vector<art::Ptr<simb::MCParticle>> &matched_mc_part_vector = assoc_mc_part.at(hit.key());
             auto matched_data_vector = assoc_mc_part.data(hit.key());
 
+            int track_idx = -1;
             for (unsigned int i_p = 0; i_p < matched_mc_part_vector.size(); i_p++)
             {
                 const art::Ptr<simb::MCParticle> &matched_mc_part = matched_mc_part_vector.at(i_p);
-                auto matched_data = matched_data_vector.at(i_p);
-
-                if (matched_data->isMaxIDE != 1)
+                if (matched_data_vector.at(i_p)->isMaxIDE != 1)
                     continue;
 
-                const int track_idx = common::isParticleElectromagnetic(matched_mc_part) ? common::getLeadElectromagneticTrack(matched_mc_part, mc_particle_map) : matched_mc_part->TrackId();
-
-                hits_to_track_map[hit.key()] = track_idx;
-                track_to_hits_map[track_idx].push_back(hit);
+                track_idx = common::isParticleElectromagnetic(matched_mc_part) ? common::getLeadElectromagneticTrack(matched_mc_part, mc_particle_map) : matched_mc_part->TrackId();
             }
-        }
 
-        std::vector<float> true_hits_u_wire;
-        std::vector<float> true_hits_u_drift;
-        std::vector<float> true_hits_u_owner;
-        std::vector<float> true_hits_v_wire;
-        std::vector<float> true_hits_v_drift;
-        std::vector<float> true_hits_v_owner;
-        std::vector<float> true_hits_w_wire;
-        std::vector<float> true_hits_w_drift;
-        std::vector<float> true_hits_w_owner;
+            if (track_idx < 0)
+                continue;
 
-        for (const art::Ptr<recob::Hit> &hit : hit_vector)
-        {
             common::PandoraView pandora_view = common::GetPandoraView(hit);
             TVector3 pandora_pos = common::GetPandoraHitPosition(e, hit, pandora_view);
+            const art::Ptr<simb::MCParticle>& owner = mc_particle_map.at(track_idx);
 
-            auto hit_to_track_it = hits_to_track_map.find(hit.key());
-            if (hit_to_track_it == hits_to_track_map.end()) {
-                continue; 
-            }
-
-            int owner_pdg_code = mc_particle_map.at(hit_to_track_it->second)->PdgCode();
-
-            if (pandora_view == common::TPC_VIEW_U) {
-                true_hits_u_wire.push_back(pandora_pos.Z());
-                true_hits_u_drift.push_back(pandora_pos.X());
-                true_hits_u_owner.push_back(owner_pdg_code);
-            }
-            else if (pandora_view == common::TPC_VIEW_V) {
-                true_hits_v_wire.push_back(pandora_pos.Z());
-                true_hits_v_drift.push_back(pandora_pos.X());
-                true_hits_v_owner.push_back(owner_pdg_code);
-            }
-            else if (pandora_view == common::TPC_VIEW_W) {
-                true_hits_w_wire.push_back(pandora_pos.Z());
-                true_hits_w_drift.push_back(pandora_pos.X());
-                true_hits_w_owner.push_back(owner_pdg_code);
-            }
+            ViewSnapshot& view = snapshot.views[pandora_view];
+            view.wire.push_back(pandora_pos.Z());
+            view.drift.push_back(pandora_pos.X());
+            view.owner_pdg.push_back(owner->PdgCode());
+            view.in_signature.push_back(patt_track_ids.count(owner->TrackId()) > 0);
         }
+    }
 
-        float global_true_drift_min = 1e5, global_true_drift_max = -1e5;
-        float wire_min_u_truth = 1e5, wire_max_u_truth = -1e5;
-        float wire_min_v_truth = 1e5, wire_max_v_truth = -1e5;
-        float wire_min_w_truth = 1e5, wire_max_w_truth = -1e5;
-        float buffer = 10.0;
+    Color_t GetPdgColour(const int pdg)
+    {
+        if (pdg == 13) return kBlue; // Muon
+        else if (pdg == 11) return kRed; // Electron
+        else if (pdg == 2212) return kGreen; // Proton
+        else if (pdg == 211) return kPink + 9; // Pion
+        else if (pdg == 22) return kOrange; // Photon
+        else if (pdg == 321) return kMagenta; // Kaon
+        else if (pdg == 3222 || pdg == 3112) return kCyan; // Sigma
+        return kGray;
+    }
 
-        getLimits(true_hits_u_wire, true_hits_u_drift, wire_min_u_truth, wire_max_u_truth, global_true_drift_min, global_true_drift_max);
-        getLimits(true_hits_v_wire, true_hits_v_drift, wire_min_v_truth, wire_max_v_truth, global_true_drift_min, global_true_drift_max);
-        getLimits(true_hits_w_wire, true_hits_w_drift, wire_min_w_truth, wire_max_w_truth, global_true_drift_min, global_true_drift_max);
+    TGraph* MakeHitGraph(const Color_t colour)
+    {
+        TGraph* graph = new TGraph();
+        graph->SetMarkerStyle(20);
+        graph->SetMarkerSize(0.5);
+        graph->SetMarkerColor(colour);
+        return graph;
+    }
 
-        TCanvas* canvas = new TCanvas("canvas", "", 1500, 1500);
-        canvas->Divide(1, 3, 0, 0);
+    // Draws the three views of a snapshot, one pad each, and saves them to
+    // snapshot.filename + suffix. Hits are coloured by owner PDG code, or as
+    // pattern against background when by_signature is set. Every ROOT object
+    // is released before returning. Renders from any thread or module take
+    // one process-wide lock, since ROOT graphics are not reentrant.
+    inline std::mutex& RenderMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
 
-        TMultiGraph* mg_u = new TMultiGraph();
-        TMultiGraph* mg_v = new TMultiGraph();
-        TMultiGraph* mg_w = new TMultiGraph();
+    void RenderSnapshot(const EventSnapshot& snapshot, const bool by_signature, const std::string& suffix)
+    {
+        std::lock_guard<std::mutex> lock(RenderMutex());
 
-        mg_u->SetTitle(";Local Drift Coordinate;Local U Wire");
-        mg_v->SetTitle(";Local Drift Coordinate;Local V Wire");
-        mg_w->SetTitle(";Local Drift Coordinate;Local W Wire");
+        auto getLimits = [](const std::vector<float>& wire_coords, const std::vector<float>& drift_coords,
+                    float& wire_min, float& wire_max, float& drift_min, float& drift_max)
+        {
+            if (!wire_coords.empty() && !drift_coords.empty()) {
+                wire_min = std::min(wire_min, *std::min_element(wire_coords.begin(), wire_coords.end()));
+                wire_max = std::max(wire_max, *std::max_element(wire_coords.begin(), wire_coords.end()));
+                drift_min = std::min(drift_min, *std::min_element(drift_coords.begin(), drift_coords.end()));
+                drift_max = std::max(drift_max, *std::max_element(drift_coords.begin(), drift_coords.end()));
 
-        std::map<int, TGraph*> pdg_graphs;
-        for (size_t i = 0; i < true_hits_u_wire.size(); ++i) {
-            int pdg = std::abs(true_hits_u_owner.at(i));
-
-            if (pdg_graphs.find(pdg) == pdg_graphs.end()) {
-                pdg_graphs[pdg] = new TGraph();
-                pdg_graphs[pdg]->SetMarkerStyle(20);
-                pdg_graphs[pdg]->SetMarkerSize(0.5);
-                pdg_graphs[pdg]->SetMarkerColor(kGray); // Default color
-
-                if (pdg == 13) pdg_graphs[pdg]->SetMarkerColor(kBlue); // Muon
-                else if (pdg == 11) pdg_graphs[pdg]->SetMarkerColor(kRed); // Electron
-                else if (pdg == 2212) pdg_graphs[pdg]->SetMarkerColor(kGreen); // Proton
-                else if (pdg == 211) pdg_graphs[pdg]->SetMarkerColor(kPink + 9); // Pion
-                else if (pdg == 22) pdg_graphs[pdg]->SetMarkerColor(kOrange); // Photon
-                else if (pdg == 321) pdg_graphs[pdg]->SetMarkerColor(kMagenta); // Kaon
-                else if (pdg == 3222 || pdg == 3112) pdg_graphs[pdg]->SetMarkerColor(kCyan); // Sigma
-            }
+                if ((wire_max - wire_min) < 100.0f) {
+                    float padd = (100.0f - (wire_max - wire_min)) / 2.0f;
+                    wire_min -= padd;
+                    wire_max += padd;
+                }
 
-            pdg_graphs[pdg]->SetPoint(pdg_graphs[pdg]->GetN(), true_hits_u_drift.at(i), true_hits_u_wire.at(i));
-        }
+                if ((drift_max - drift_min) < 100.0f) {
+                    float padd = (100.0f - (drift_max - drift_min)) / 2.0f;
+                    drift_min -= padd;
+                    drift_max += padd;
+                }
+            }
+        };
 
-        for (auto& entry : pdg_graphs) {
-            mg_u->Add(entry.second);
-        }
+        static const std::array<const char*, 3> titles = {";Local Drift Coordinate;Local U Wire", ";Local Drift Coordinate;Local V Wire", ";Local Drift Coordinate;Local W Wire"};
 
-        canvas->cd(1);
-        mg_u->Draw("AP");
-        mg_u->GetXaxis()->SetLimits(global_true_drift_min - buffer, global_true_drift_max + buffer);
-        mg_u->GetYaxis()->SetRangeUser(wire_min_u_truth, wire_max_u_truth);
-        mg_u->GetXaxis()->SetTitleSize(0.05);  
-        mg_u->GetYaxis()->SetTitleSize(0.05);
+        float global_drift_min = 1e5, global_drift_max = -1e5;
+        std::array<float, 3> wire_min = {1e5, 1e5, 1e5};
+        std::array<float, 3> wire_max = {-1e5, -1e5, -1e5};
+        float buffer = 10.0;
 
-        pdg_graphs.clear(); 
-
-        // Repeat for V view
-        for (size_t i = 0; i < true_hits_v_wire.size(); ++i) {
-            int pdg = std::abs(true_hits_v_owner.at(i));
-
-            if (pdg_graphs.find(pdg) == pdg_graphs.end()) {
-                pdg_graphs[pdg] = new TGraph();
-                pdg_graphs[pdg]->SetMarkerStyle(20);
-                pdg_graphs[pdg]->SetMarkerSize(0.5);
-                pdg_graphs[pdg]->SetMarkerColor(kGray); // Default color
-
-                if (pdg == 13) pdg_graphs[pdg]->SetMarkerColor(kBlue); // Muon
-                else if (pdg == 11) pdg_graphs[pdg]->SetMarkerColor(kRed); // Electron
-                else if (pdg == 2212) pdg_graphs[pdg]->SetMarkerColor(kGreen); // Proton
-                else if (pdg == 211) pdg_graphs[pdg]->SetMarkerColor(kPink + 9); // Pion
-                else if (pdg == 22) pdg_graphs[pdg]->SetMarkerColor(kOrange); // Photon
-                else if (pdg == 321) pdg_graphs[pdg]->SetMarkerColor(kMagenta); // Kaon
-                else if (pdg == 3222 || pdg == 3112) pdg_graphs[pdg]->SetMarkerColor(kCyan); // Sigma
-            }
+        for (size_t v = 0; v < snapshot.views.size(); ++v)
+            getLimits(snapshot.views[v].wire, snapshot.views[v].drift, wire_min[v], wire_max[v], global_drift_min, global_drift_max);
 
-            pdg_graphs[pdg]->SetPoint(pdg_graphs[pdg]->GetN(), true_hits_v_drift.at(i), true_hits_v_wire.at(i));
-        }
+        TCanvas canvas(("canvas_" + snapshot.filename + suffix).c_str(), "", 1500, 1500);
+        canvas.Divide(1, 3, 0, 0);
 
-        for (auto& entry : pdg_graphs) {
-            mg_v->Add(entry.second);
-        }
+        // The multigraphs own their graphs and are destroyed before the canvas.
+        std::array<std::unique_ptr<TMultiGraph>, 3> multigraphs;
+        for (size_t v = 0; v < snapshot.views.size(); ++v)
+        {
+            const ViewSnapshot& view = snapshot.views[v];
+            auto mg = std::make_unique<TMultiGraph>();
+            mg->SetTitle(titles[v]);
+
+            if (by_signature) {
+                TGraph* sig = MakeHitGraph(kGreen);
+                TGraph* back = MakeHitGraph(kGray);
+                for (size_t i = 0; i < view.size(); ++i) {
+                    TGraph* graph = view.in_signature[i] ? sig : back;
+                    graph->SetPoint(graph->GetN(), view.drift[i], view.wire[i]);
+                }
 
-        canvas->cd(2);
-        mg_v->Draw("AP");
-        mg_v->GetXaxis()->SetLimits(global_true_drift_min - buffer, global_true_drift_max + buffer);
-        mg_v->GetYaxis()->SetRangeUser(wire_min_v_truth, wire_max_v_truth);
-        mg_v->GetXaxis()->SetTitleSize(0.05);  
-        mg_v->GetYaxis()->SetTitleSize(0.05);
+                mg->Add(sig);
+                mg->Add(back);
+            }
+            else {
+                std::map<int, TGraph*> pdg_graphs;
+                for (size_t i = 0; i < view.size(); ++i) {
+                    int pdg = std::abs(view.owner_pdg[i]);
+                    auto it = pdg_graphs.find(pdg);
+                    if (it == pdg_graphs.end())
+                        it = pdg_graphs.emplace(pdg, MakeHitGraph(GetPdgColour(pdg))).first;
+
+                    it->second->SetPoint(it->second->GetN(), view.drift[i], view.wire[i]);
+                }
 
-        pdg_graphs.clear(); 
-
-        // Repeat for W view
-        for (size_t i = 0; i < true_hits_w_wire.size(); ++i) {
-            int pdg = std::abs(true_hits_w_owner.at(i));
-
-            if (pdg_graphs.find(pdg) == pdg_graphs.end()) {
-                pdg_graphs[pdg] = new TGraph();
-                pdg_graphs[pdg]->SetMarkerStyle(20);
-                pdg_graphs[pdg]->SetMarkerSize(0.5);
-                pdg_graphs[pdg]->SetMarkerColor(kGray); // Default color
-
-                if (pdg == 13) pdg_graphs[pdg]->SetMarkerColor(kBlue); // Muon
-                else if (pdg == 11) pdg_graphs[pdg]->SetMarkerColor(kRed); // Electron
-                else if (pdg == 2212) pdg_graphs[pdg]->SetMarkerColor(kGreen); // Proton
-                else if (pdg == 211) pdg_graphs[pdg]->SetMarkerColor(kPink + 9); // Pion
-                else if (pdg == 22) pdg_graphs[pdg]->SetMarkerColor(kOrange); // Photon
-                else if (pdg == 321) pdg_graphs[pdg]->SetMarkerColor(kMagenta); // Kaon
-                else if (pdg == 3222 || pdg == 3112) pdg_graphs[pdg]->SetMarkerColor(kCyan); // Sigma
+                for (auto& entry : pdg_graphs)
+                    mg->Add(entry.second);
             }
 
-            pdg_graphs[pdg]->SetPoint(pdg_graphs[pdg]->GetN(), true_hits_w_drift.at(i), true_hits_w_wire.at(i));
+            canvas.cd(v + 1);
+            mg->Draw("AP");
+            mg->GetXaxis()->SetLimits(global_drift_min - buffer, global_drift_max + buffer);
+            mg->GetYaxis()->SetRangeUser(wire_min[v], wire_max[v]);
+            mg->GetXaxis()->SetTitleSize(0.05);  
+            mg->GetYaxis()->SetTitleSize(0.05);
+            multigraphs[v] = std::move(mg);
         }
 
-        for (auto& entry : pdg_graphs) {
-            mg_w->Add(entry.second);
-        }
+        canvas.SaveAs((snapshot.filename + suffix).c_str());
+    }
 
-        canvas->cd(3);
-        mg_w->Draw("AP");
-        mg_w->GetXaxis()->SetLimits(global_true_drift_min - buffer, global_true_drift_max + buffer);
-        mg_w->GetYaxis()->SetRangeUser(wire_min_w_truth, wire_max_w_truth);
-        mg_w->GetXaxis()->SetTitleSize(0.05);  
-        mg_w->GetYaxis()->SetTitleSize(0.05);
-        canvas->SaveAs((filename + "_truth_hits.png").c_str());
+    void RenderTruthHits(const EventSnapshot& snapshot) { RenderSnapshot(snapshot, false, "_truth_hits.png"); }
+    void RenderSignatureHits(const EventSnapshot& snapshot) { RenderSnapshot(snapshot, true, "_signature_hits.png"); }
 
-        delete canvas;
-        delete mg_u;
-        delete mg_v;
-        delete mg_w;
+    void visualiseTrueEvent(const art::Event& e,
+                    const art::InputTag& mcp_producer,
+                    const art::InputTag& hit_producer,
+                    const art::InputTag& backtrack_tag,
+                    const std::string& filename)
+    {
+        EventSnapshot snapshot;
+        SnapshotEvent(e, mcp_producer, hit_producer, backtrack_tag, signature::Pattern(), filename, snapshot);
+        RenderTruthHits(snapshot);
     }
 
     /*void visualisePandoraEvent()
@@ -637,7 +628,6 @@ namespace common
         delete mg_w;
     }*/
 
-
     void visualiseSignature(const art::Event& e,
                     const art::InputTag& mcp_producer,
                     const art::InputTag& hit_producer,
@@ -645,247 +635,9 @@ namespace common
                     const signature::Pattern& patt,
                     const std::string& filename)
     {
-        auto getLimits = [](const std::vector<float>& wire_coords, const std::vector<float>& drift_coords,
-                    float& wire_min, float& wire_max, float& drift_min, float& drift_max)
-        {
-            if (!wire_coords.empty() && !drift_coords.empty()) {
-                wire_min = std::min(wire_min, *std::min_element(wire_coords.begin(), wire_coords.end()));
-                wire_max = std::max(wire_max, *std::max_element(wire_coords.begin(), wire_coords.end()));
-                drift_min = std::min(drift_min, *std::min_element(drift_coords.begin(), drift_coords.end()));
-                drift_max = std::max(drift_max, *std::max_element(drift_coords.begin(), drift_coords.end()));
-
-                if ((wire_max - wire_min) < 100.0f) {
-                    float padd = (100.0f - (wire_max - wire_min)) / 2.0f;
-                    wire_min -= padd;
-                    wire_max += padd;
-                }
-
-                if ((drift_max - drift_min) < 100.0f) {
-                    float padd = (100.0f - (drift_max - drift_min)) / 2.0f;
-                    drift_min -= padd;
-                    drift_max += padd;
-                }
-            }
-        };
-
-        art::Handle<std::vector<simb::MCParticle>> mc_particle_handle; 
-        std::vector<art::Ptr<simb::MCParticle>> mc_particle_vector;
-        lar_pandora::MCParticleMap mc_particle_map;
-
-        if (!e.getByLabel(mcp_producer, mc_particle_handle))
-            throw cet::exception("Common") << "failed to find any mc particles in event" << std::endl;
-        art::fill_ptr_vector(mc_particle_vector, mc_particle_handle);
-        lar_pandora::LArPandoraHelper::BuildMCParticleMap(mc_particle_vector, mc_particle_map);
-
-        art::Handle<std::vector<recob::Hit>> evt_hits;
-        std::vector<art::Ptr<recob::Hit>> hit_vector;
-        
-        if (!e.getByLabel(hit_producer, evt_hits))
-            throw cet::exception("Common") << "failed to find any hits in event" << std::endl;
-        art::fill_ptr_vector(hit_vector, evt_hits);
-        art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData> assoc_mc_part = art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>(evt_hits, e, backtrack_tag);
-
-        std::map<int, int> hits_to_track_map;
-        std::map<int, std::vector<art::Ptr<recob::Hit>>> track_to_hits_map;
-
-        for (unsigned int i_h = 0; i_h < hit_vector.size(); i_h++)
-        {
-            const art::Ptr<recob::Hit> &hit = hit_vector[i_h];
-            const std::vector<art::Ptr<simb::MCParticle>> &matched_mc_part_vector = assoc_mc_part.at(hit.key());
-            auto matched_data_vector = assoc_mc_part.data(hit.key());
-
-            for (unsigned int i_p = 0; i_p < matched_mc_part_vector.size(); i_p++)
-            {
-                const art::Ptr<simb::MCParticle> &matched_mc_part = matched_mc_part_vector.at(i_p);
-                auto matched_data = matched_data_vector.at(i_p);
-
-                if (matched_data->isMaxIDE != 1)
-                    continue;
-
-                const int track_idx = common::isParticleElectromagnetic(matched_mc_part) ? common::getLeadElectromagneticTrack(matched_mc_part, mc_particle_map) : matched_mc_part->TrackId();
-
-                hits_to_track_map[hit.key()] = track_idx;
-                track_to_hits_map[track_idx].push_back(hit);
-            }
-        }
-
-        std::vector<float> true_hits_u_wire;
-        std::vector<float> true_hits_u_drift;
-        std::vector<float> true_hits_u_owner;
-        std::vector<float> true_hits_v_wire;
-        std::vector<float> true_hits_v_drift;
-        std::vector<float> true_hits_v_owner;
-        std::vector<float> true_hits_w_wire;
-        std::vector<float> true_hits_w_drift;
-        std::vector<float> true_hits_w_owner;
-
-        for (const art::Ptr<recob::Hit> &hit : hit_vector)
-        {
-            common::PandoraView pandora_view = common::GetPandoraView(hit);
-            TVector3 pandora_pos = common::GetPandoraHitPosition(e, hit, pandora_view);
-
-            auto hit_to_track_it = hits_to_track_map.find(hit.key());
-            if (hit_to_track_it == hits_to_track_map.end()) {
-                continue; 
-            }
-
-            int owner_trackid = mc_particle_map.at(hit_to_track_it->second)->TrackId();
-
-            if (pandora_view == common::TPC_VIEW_U) {
-                true_hits_u_wire.push_back(pandora_pos.Z());
-                true_hits_u_drift.push_back(pandora_pos.X());
-                true_hits_u_owner.push_back(owner_trackid);
-            }
-            else if (pandora_view == common::TPC_VIEW_V) {
-                true_hits_v_wire.push_back(pandora_pos.Z());
-                true_hits_v_drift.push_back(pandora_pos.X());
-                true_hits_v_owner.push_back(owner_trackid);
-            }
-            else if (pandora_view == common::TPC_VIEW_W) {
-                true_hits_w_wire.push_back(pandora_pos.Z());
-                true_hits_w_drift.push_back(pandora_pos.X());
-                true_hits_w_owner.push_back(owner_trackid);
-            }
-        }
-
-        float global_true_drift_min = 1e5, global_true_drift_max = -1e5;
-        float wire_min_u_truth = 1e5, wire_max_u_truth = -1e5;
-        float wire_min_v_truth = 1e5, wire_max_v_truth = -1e5;
-        float wire_min_w_truth = 1e5, wire_max_w_truth = -1e5;
-        float buffer = 10.0;
-
-        getLimits(true_hits_u_wire, true_hits_u_drift, wire_min_u_truth, wire_max_u_truth, global_true_drift_min, global_true_drift_max);
-        getLimits(true_hits_v_wire, true_hits_v_drift, wire_min_v_truth, wire_max_v_truth, global_true_drift_min, global_true_drift_max);
-        getLimits(true_hits_w_wire, true_hits_w_drift, wire_min_w_truth, wire_max_w_truth, global_true_drift_min, global_true_drift_max);
-
-        TCanvas* canvas = new TCanvas("canvas", "", 1500, 1500);
-        canvas->Divide(1, 3, 0, 0);
-
-        TMultiGraph* mg_u = new TMultiGraph();
-        TMultiGraph* mg_v = new TMultiGraph();
-        TMultiGraph* mg_w = new TMultiGraph();
-
-        mg_u->SetTitle(";Local Drift Coordinate;Local U Wire");
-        mg_v->SetTitle(";Local Drift Coordinate;Local V Wire");
-        mg_w->SetTitle(";Local Drift Coordinate;Local W Wire");
-
-        TGraph* sig_u = new TGraph();
-        sig_u->SetMarkerStyle(20);
-        sig_u->SetMarkerSize(0.5);
-        sig_u->SetMarkerColor(kGreen);
-
-        TGraph* back_u = new TGraph();
-        back_u->SetMarkerStyle(20);
-        back_u->SetMarkerSize(0.5);
-        back_u->SetMarkerColor(kGray);
-        for (size_t i = 0; i < true_hits_u_wire.size(); ++i) {
-            int trackid = std::abs(true_hits_u_owner.at(i));
-
-            bool is_sig = false;
-            for (const auto& signature : patt) {
-                for (const auto& mcp : signature) {
-                    if (mcp->TrackId() == trackid){
-                        is_sig = true; 
-                    }
-                }
-            }
-
-            if (is_sig)
-                sig_u->SetPoint(sig_u->GetN(), true_hits_u_drift.at(i), true_hits_u_wire.at(i));
-            else if (!is_sig) 
-                back_u->SetPoint(back_u->GetN(), true_hits_u_drift.at(i), true_hits_u_wire.at(i));
-        }
-
-        mg_u->Add(sig_u); 
-        mg_u->Add(back_u);
-
-        canvas->cd(1);
-        mg_u->Draw("AP");
-        mg_u->GetXaxis()->SetLimits(global_true_drift_min - buffer, global_true_drift_max + buffer);
-        mg_u->GetYaxis()->SetRangeUser(wire_min_u_truth, wire_max_u_truth);
-        mg_u->GetXaxis()->SetTitleSize(0.05);  
-        mg_u->GetYaxis()->SetTitleSize(0.05);
-
-        TGraph* sig_v = new TGraph();
-        sig_v->SetMarkerStyle(20);
-        sig_v->SetMarkerSize(0.5);
-        sig_v->SetMarkerColor(kGreen);
-
-        TGraph* back_v = new TGraph();
-        back_v->SetMarkerStyle(20);
-        back_v->SetMarkerSize(0.5);
-        back_v->SetMarkerColor(kGray);
-        for (size_t i = 0; i < true_hits_v_wire.size(); ++i) {
-            int trackid = std::abs(true_hits_v_owner.at(i));
-
-            bool is_sig = false;
-            for (const auto& signature : patt) {
-                for (const auto& mcp : signature) {
-                    if (mcp->TrackId() == trackid){
-                        is_sig = true; 
-                    }
-                }
-            }
-
-            if (is_sig)
-                sig_v->SetPoint(sig_v->GetN(), true_hits_v_drift.at(i), true_hits_v_wire.at(i));
-            else if (!is_sig) 
-                back_v->SetPoint(back_v->GetN(), true_hits_v_drift.at(i), true_hits_v_wire.at(i));
-        }
-
-        mg_v->Add(sig_v); 
-        mg_v->Add(back_v);
-
-        canvas->cd(2);
-        mg_v->Draw("AP");
-        mg_v->GetXaxis()->SetLimits(global_true_drift_min - buffer, global_true_drift_max + buffer);
-        mg_v->GetYaxis()->SetRangeUser(wire_min_v_truth, wire_max_v_truth);
-        mg_v->GetXaxis()->SetTitleSize(0.05);  
-        mg_v->GetYaxis()->SetTitleSize(0.05);
-
-
-        TGraph* sig_w = new TGraph();
-        sig_w->SetMarkerStyle(20);
-        sig_w->SetMarkerSize(0.5);
-        sig_w->SetMarkerColor(kGreen);
-
-        TGraph* back_w = new TGraph();
-        back_w->SetMarkerStyle(20);
-        back_w->SetMarkerSize(0.5);
-        back_w->SetMarkerColor(kGray);
-        for (size_t i = 0; i < true_hits_w_wire.size(); ++i) {
-            int trackid = std::abs(true_hits_w_owner.at(i));
-
-            bool is_sig = false;
-            for (const auto& signature : patt) {
-                for (const auto& mcp : signature) {
-                    if (mcp->TrackId() == trackid){
-                        is_sig = true; 
-                    }
-                }
-            }
-
-            if (is_sig)
-                sig_w->SetPoint(sig_w->GetN(), true_hits_w_drift.at(i), true_hits_w_wire.at(i));
-            else if (!is_sig) 
-                back_w->SetPoint(back_w->GetN(), true_hits_w_drift.at(i), true_hits_w_wire.at(i));
-        }
-
-        mg_w->Add(sig_w); 
-        mg_w->Add(back_w);
-
-        canvas->cd(3);
-        mg_w->Draw("AP");
-        mg_w->GetXaxis()->SetLimits(global_true_drift_min - buffer, global_true_drift_max + buffer);
-        mg_w->GetYaxis()->SetRangeUser(wire_min_w_truth, wire_max_w_truth);
-        mg_w->GetXaxis()->SetTitleSize(0.05);  
-        mg_w->GetYaxis()->SetTitleSize(0.05);
-        canvas->SaveAs((filename + "_signature_hits.png").c_str());
-
-        delete canvas;
-        delete mg_u;
-        delete mg_v;
-        delete mg_w;
+        EventSnapshot snapshot;
+        SnapshotEvent(e, mcp_producer, hit_producer, backtrack_tag, patt, filename, snapshot);
+        RenderSignatureHits(snapshot);
     }
 
 }
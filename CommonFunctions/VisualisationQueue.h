@@ -0,0 +1,134 @@
+#ifndef VISUALISATIONQUEUE_H
+#define VISUALISATIONQUEUE_H
+
+#include "CommonFunctions/Visualisation.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace common
+{
+    // Renders event snapshots on a single background thread so that drawing
+    // and writing images stays off the event loop. At most max_pending
+    // snapshots are held; push() blocks while the queue is full, which bounds
+    // memory when rendering falls behind. flush() waits until everything
+    // pushed so far has been written, and rethrows the first exception a
+    // render raised since the last flush. Jobs share one queue through
+    // VisualisationService; drawing itself is serialised by RenderSnapshot.
+    class VisualisationQueue
+    {
+    public:
+        explicit VisualisationQueue(size_t max_pending)
+            : _max_pending{max_pending > 0 ? max_pending : 1}
+        {
+            _worker = std::thread([this] { this->work(); });
+        }
+
+        ~VisualisationQueue()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stopping = true;
+            }
+            _pending_cv.notify_all();
+            _worker.join();
+        }
+
+        VisualisationQueue(const VisualisationQueue&) = delete;
+        VisualisationQueue& operator=(const VisualisationQueue&) = delete;
+
+        void push(EventSnapshot snapshot)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _space_cv.wait(lock, [this] { return _pending.size() < _max_pending; });
+            _pending.push_back(std::move(snapshot));
+            _pending_cv.notify_one();
+        }
+
+        void flush()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _idle_cv.wait(lock, [this] { return _pending.empty() && !_busy; });
+
+            if (_error)
+            {
+                std::exception_ptr error = _error;
+                _error = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+
+        size_t rendered() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _n_rendered;
+        }
+
+        size_t failed() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _n_failed;
+        }
+
+    private:
+        void work()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true)
+            {
+                _pending_cv.wait(lock, [this] { return _stopping || !_pending.empty(); });
+                if (_pending.empty())
+                    return;
+
+                EventSnapshot snapshot = std::move(_pending.front());
+                _pending.pop_front();
+                _busy = true;
+                _space_cv.notify_one();
+                lock.unlock();
+
+                std::exception_ptr error;
+                try {
+                    if (snapshot.render_truth)
+                        RenderTruthHits(snapshot);
+                    if (snapshot.render_signature)
+                        RenderSignatureHits(snapshot);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+
+                lock.lock();
+                _busy = false;
+                if (error)
+                {
+                    _n_failed += 1;
+                    if (!_error)
+                        _error = error;
+                }
+                else
+                {
+                    _n_rendered += 1;
+                }
+                _idle_cv.notify_all();
+            }
+        }
+
+        size_t _max_pending;
+        std::deque<EventSnapshot> _pending;
+        bool _busy = false;
+        bool _stopping = false;
+        size_t _n_rendered = 0;
+        size_t _n_failed = 0;
+        std::exception_ptr _error;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _pending_cv;
+        std::condition_variable _space_cv;
+        std::condition_variable _idle_cv;
+        std::thread _worker;
+    };
+}
+
+#endif
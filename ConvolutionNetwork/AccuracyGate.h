@@ -0,0 +1,76 @@
+#ifndef ACCURACYGATE_H
+#define ACCURACYGATE_H
+
+#include "ConvolutionNetwork/InferenceQueue.h"
+#include "ConvolutionNetwork/SparseImage.h"
+
+#ifdef ClassDef
+#undef ClassDef
+#endif
+#include <torch/torch.h>
+#include <torch/script.h>
+
+#include <numeric>
+#include <vector>
+
+namespace network
+{
+    struct AgreementStats
+    {
+        size_t n_events = 0;
+        size_t n_hits = 0;
+        size_t n_agree = 0;
+
+        double agreement() const { return n_hits > 0 ? static_cast<double>(n_agree) / n_hits : 0.; }
+    };
+
+    // Runs the same images through one model whole and in tiles, each
+    // through an InferenceQueue as the module would, and counts the hits whose
+    // predicted class agrees. With a halo of at least the receptive-field
+    // radius every hit should agree.
+    inline AgreementStats CompareTiled(const Model& model, common::PandoraView view, const std::vector<SparseImage>& images, const TileConfig& tiles)
+    {
+        std::vector<std::vector<int>> full_classes(images.size()), tiled_classes(images.size());
+        for (auto* classes : {&full_classes, &tiled_classes})
+        {
+            InferenceQueue queue({{view, model}}, 1, [classes](InferenceResult&& result) {
+                (*classes)[result.event] = std::move(result.hit_classes);
+            }, classes == &full_classes ? TileConfig() : tiles);
+
+            for (size_t e = 0; e < images.size(); ++e)
+            {
+                InferenceRequest request;
+                request.run = 0;
+                request.subrun = 0;
+                request.event = static_cast<int>(e);
+                request.view = view;
+                request.image = images[e];
+                request.hit_keys.resize(images[e].hit_pixel.size());
+                std::iota(request.hit_keys.begin(), request.hit_keys.end(), 0);
+                queue.push(std::move(request));
+            }
+
+            queue.flush();
+        }
+
+        AgreementStats stats;
+        for (size_t e = 0; e < images.size(); ++e)
+        {
+            for (size_t i = 0; i < full_classes[e].size(); ++i)
+            {
+                if (full_classes[e][i] < 0)
+                    continue;
+
+                stats.n_hits += 1;
+                if (i < tiled_classes[e].size() && tiled_classes[e][i] == full_classes[e][i])
+                    stats.n_agree += 1;
+            }
+
+            stats.n_events += 1;
+        }
+
+        return stats;
+    }
+}
+
+#endif
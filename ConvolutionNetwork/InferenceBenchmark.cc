@@ -0,0 +1,502 @@
+#include "ConvolutionNetwork/AccuracyGate.h"
+#include "ConvolutionNetwork/InferenceQueue.h"
+#include "ConvolutionNetwork/ModelLoader.h"
+#include "ConvolutionNetwork/SampleImage.h"
+
+#include <ATen/Parallel.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures the cost of the U/V/W segmentation models outside a lar job.
+// Images are either synthetic (uniformly scattered random hits) or replayed
+// from training/calibration shards written by ConvolutionNetworkAlgo. Every
+// combination of batch size, intra-op threads and concurrent workers is
+// timed through the same InferenceQueue the module uses, and the results are
+// printed as one JSON document.
+//
+//   inference_benchmark --model-u U.pt --model-v V.pt --model-w W.pt
+//       [--images-u U_0000.bin,... --images-v ... --images-w ...]
+//       [--synthetic-events 200 --synthetic-hits 2000]
+//       [--batch-sizes 1,4,16] [--intra-threads 1,4] [--workers 1,2]
+//       [--height 256 --width 256] [--iterations 3] [--output result.json]
+//       [--tile-size 64 --tile-halo 32 --tile-alignment 16] [--tile-min-agreement 1]
+//
+// With tiling enabled, every model is also run whole and tiled on the same
+// images and the per-hit class agreement of the two is reported under
+// "tile_checks"; the benchmark exits with status 2 if any falls below
+// --tile-min-agreement.
+//
+// Workers stand in for art schedules: like the module's, they share one
+// queue and each runs the forwards of the batches it fills concurrently with
+// the others (the libtorch in use has no inter-op pool setting of its own).
+//
+// Every configuration, and the tile check, runs in a forked child that loads
+// and warms up its own copy of the models, so that load times, peak RSS and
+// the RSS growth over the child's starting point ("rss_delta_kb", i.e. models
+// plus inference buffers) belong to that configuration alone. The parent only
+// builds the images and never touches libtorch, whose thread pools do not
+// survive a fork.
+
+namespace
+{
+    using network::Model;
+    using ViewImages = std::map<common::PandoraView, std::vector<network::SparseImage>>;
+
+    const std::vector<common::PandoraView> kViews = {common::TPC_VIEW_U, common::TPC_VIEW_V, common::TPC_VIEW_W};
+
+    std::vector<std::string> split(const std::string& list)
+    {
+        std::vector<std::string> items;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ','))
+        {
+            if (!item.empty())
+                items.push_back(item);
+        }
+        return items;
+    }
+
+    std::vector<int> splitInts(const std::string& list)
+    {
+        std::vector<int> values;
+        for (const auto& item : split(list))
+            values.push_back(std::stoi(item));
+        return values;
+    }
+
+    ViewImages syntheticImages(size_t n_events, size_t n_hits, int height, int width)
+    {
+        std::mt19937 rng(12345);
+        std::uniform_real_distribution<float> x_dist(0.f, static_cast<float>(width));
+        std::uniform_real_distribution<float> z_dist(0.f, static_cast<float>(height));
+        std::exponential_distribution<float> q_dist(1.f / 5000.f);
+
+        network::SparseImageBuilder builder{height, width};
+        ViewImages images;
+        std::vector<float> x(n_hits), z(n_hits), q(n_hits);
+        for (auto view : kViews)
+        {
+            for (size_t e = 0; e < n_events; ++e)
+            {
+                for (size_t i = 0; i < n_hits; ++i)
+                {
+                    x[i] = x_dist(rng);
+                    z[i] = z_dist(rng);
+                    q[i] = q_dist(rng);
+                }
+
+                network::SparseImage image;
+                builder.build(x, z, q, 0.f, static_cast<float>(width), 0.f, static_cast<float>(height), image);
+                images[view].push_back(std::move(image));
+            }
+        }
+
+        return images;
+    }
+
+    ViewImages replayedImages(const std::map<common::PandoraView, std::vector<std::string>>& files, int height, int width)
+    {
+        network::SparseImageBuilder builder{height, width};
+        ViewImages images;
+        for (const auto& [view, paths] : files)
+        {
+            network::TrainingShardReader reader(paths);
+            for (size_t e = 0; e < reader.size(); ++e)
+            {
+                network::SparseImage image;
+                network::BuildSampleImage(reader.event(e), builder, height, width, image);
+                images[view].push_back(std::move(image));
+            }
+        }
+
+        return images;
+    }
+
+    double percentile(std::vector<double> values, double fraction)
+    {
+        if (values.empty())
+            return 0.;
+
+        std::sort(values.begin(), values.end());
+        size_t index = static_cast<size_t>(fraction * (values.size() - 1) + 0.5);
+        return values[std::min(index, values.size() - 1)];
+    }
+
+    long statusKilobytes(const std::string& field)
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.rfind(field + ":", 0) == 0)
+                return std::stol(line.substr(field.size() + 1));
+        }
+        return 0;
+    }
+
+    // Restarts the kernel's RSS high-water mark from the current RSS, so that
+    // a child's VmHWM does not include what the parent peaked at.
+    bool resetPeakRSS()
+    {
+        std::ofstream clear_refs("/proc/self/clear_refs");
+        clear_refs << "5";
+        clear_refs.flush();
+        return static_cast<bool>(clear_refs);
+    }
+
+    // Runs work in a forked child and returns what it computed. T is passed
+    // back through a pipe byte for byte, so it must be trivially copyable.
+    template <typename T>
+    T runInChild(const std::function<T()>& work)
+    {
+        int fds[2];
+        if (::pipe(fds) != 0)
+            throw std::runtime_error(std::string("pipe failed: ") + std::strerror(errno));
+
+        std::cout.flush();
+        std::cerr.flush();
+        const pid_t pid = ::fork();
+        if (pid < 0)
+            throw std::runtime_error(std::string("fork failed: ") + std::strerror(errno));
+
+        if (pid == 0)
+        {
+            ::close(fds[0]);
+            int status = 0;
+            try {
+                const T result = work();
+                const char* data = reinterpret_cast<const char*>(&result);
+                for (size_t written = 0; written < sizeof(T) && status == 0;)
+                {
+                    const ssize_t n = ::write(fds[1], data + written, sizeof(T) - written);
+                    if (n <= 0)
+                        status = 1;
+                    else
+                        written += n;
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "inference_benchmark: " << e.what() << std::endl;
+                status = 1;
+            }
+            ::close(fds[1]);
+            ::_exit(status);
+        }
+
+        ::close(fds[1]);
+        T result;
+        char* data = reinterpret_cast<char*>(&result);
+        size_t read_bytes = 0;
+        while (read_bytes < sizeof(T))
+        {
+            const ssize_t n = ::read(fds[0], data + read_bytes, sizeof(T) - read_bytes);
+            if (n <= 0)
+                break;
+            read_bytes += n;
+        }
+        ::close(fds[0]);
+
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        if (read_bytes != sizeof(T) || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            throw std::runtime_error("benchmark child process failed");
+
+        return result;
+    }
+
+    std::map<common::PandoraView, Model> loadModels(network::ModelLoader& loader, const std::map<common::PandoraView, std::string>& paths)
+    {
+        std::map<common::PandoraView, Model> models;
+        for (const auto& [view, path] : paths)
+            models[view] = loader.load(path);
+        return models;
+    }
+
+    struct RunResult
+    {
+        int batch_size;
+        int intra_threads;
+        int workers;
+        size_t n_events;
+        size_t n_forwards;
+        double wall_seconds;
+        double p50_seconds;
+        double p99_seconds;
+        double events_per_second;
+        double images_per_second;
+        double tile_skip_fraction;
+        double load_seconds;
+        double warmup_seconds;
+        long peak_rss_kb;
+        long rss_delta_kb;
+    };
+
+    // Loads and warms up the models for this batch size only, then workers
+    // take events from a shared counter and push their three views through
+    // one shared queue; latency is each image's time from push to result.
+    // Meant to run in a child of its own (see runInChild).
+    RunResult runConfiguration(const std::map<common::PandoraView, std::string>& model_paths, const ViewImages& images,
+                               int height, int width, int batch_size, int intra_threads, int workers, int iterations, int warmup,
+                               const network::TileConfig& tiles)
+    {
+        const bool peak_reset = resetPeakRSS();
+        const long baseline_rss_kb = statusKilobytes("VmRSS");
+
+        at::set_num_threads(intra_threads);
+
+        network::ModelLoader loader;
+        const std::map<common::PandoraView, Model> models = loadModels(loader, model_paths);
+        loader.warmUp({models.at(common::TPC_VIEW_U), models.at(common::TPC_VIEW_V), models.at(common::TPC_VIEW_W)}, height, width, {batch_size}, warmup);
+
+        size_t n_events = images.at(common::TPC_VIEW_U).size();
+        for (auto view : kViews)
+            n_events = std::min(n_events, images.at(view).size());
+
+        std::vector<double> latencies;
+        std::mutex latency_mutex;
+        network::InferenceQueue queue(models, batch_size, [&](network::InferenceResult&& result) {
+            std::lock_guard<std::mutex> lock(latency_mutex);
+            latencies.push_back(result.latency_seconds);
+        }, tiles);
+
+        std::atomic<size_t> next_event{0};
+        const size_t total_events = n_events * iterations;
+
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for (int w = 0; w < workers; ++w)
+        {
+            threads.emplace_back([&]() {
+                for (size_t e = next_event++; e < total_events; e = next_event++)
+                {
+                    for (auto view : kViews)
+                    {
+                        network::InferenceRequest request;
+                        request.run = 0;
+                        request.subrun = 0;
+                        request.event = static_cast<int>(e);
+                        request.view = view;
+                        request.image = images.at(view)[e % n_events];
+                        queue.push(std::move(request));
+                    }
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        queue.flush();
+        auto finish = std::chrono::steady_clock::now();
+        const auto stats = queue.stats();
+
+        RunResult result;
+        result.batch_size = batch_size;
+        result.intra_threads = intra_threads;
+        result.workers = workers;
+        result.n_events = total_events;
+        result.n_forwards = stats.n_batches;
+        result.wall_seconds = std::chrono::duration<double>(finish - start).count();
+        result.p50_seconds = percentile(latencies, 0.50);
+        result.p99_seconds = percentile(latencies, 0.99);
+        result.events_per_second = result.wall_seconds > 0. ? total_events / result.wall_seconds : 0.;
+        result.images_per_second = result.events_per_second * kViews.size();
+        result.tile_skip_fraction = stats.tileSkipFraction();
+        result.load_seconds = loader.stats().load_seconds;
+        result.warmup_seconds = loader.stats().warmup_seconds;
+        result.peak_rss_kb = statusKilobytes("VmHWM");
+        if (!peak_reset)
+            result.peak_rss_kb = std::max(result.peak_rss_kb, statusKilobytes("VmRSS"));
+        result.rss_delta_kb = result.peak_rss_kb - baseline_rss_kb;
+        return result;
+    }
+
+    struct TileCheck
+    {
+        common::PandoraView view;
+        network::AgreementStats stats;
+    };
+
+    struct TileChecks
+    {
+        TileCheck views[3];
+    };
+
+    TileChecks checkTiling(const std::map<common::PandoraView, std::string>& model_paths, const ViewImages& images, const network::TileConfig& tiles)
+    {
+        network::ModelLoader loader;
+        const std::map<common::PandoraView, Model> models = loadModels(loader, model_paths);
+
+        TileChecks checks;
+        for (size_t i = 0; i < kViews.size(); ++i)
+            checks.views[i] = TileCheck{kViews[i], network::CompareTiled(models.at(kViews[i]), kViews[i], images.at(kViews[i]), tiles)};
+        return checks;
+    }
+
+    void writeJSON(std::ostream& out, const std::map<std::string, std::string>& config, const std::vector<RunResult>& results,
+                   const std::vector<TileCheck>& tile_checks)
+    {
+        out << "{\n  \"config\": {";
+        bool first = true;
+        for (const auto& [key, value] : config)
+        {
+            out << (first ? "" : ",") << "\n    \"" << key << "\": \"" << value << "\"";
+            first = false;
+        }
+
+        out << "\n  },\n  \"runs\": [";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const RunResult& r = results[i];
+            out << (i == 0 ? "" : ",") << "\n    {"
+                << "\"batch_size\": " << r.batch_size << ", "
+                << "\"intra_threads\": " << r.intra_threads << ", "
+                << "\"workers\": " << r.workers << ", "
+                << "\"events\": " << r.n_events << ", "
+                << "\"forwards\": " << r.n_forwards << ", "
+                << "\"wall_seconds\": " << r.wall_seconds << ", "
+                << "\"latency_p50_seconds\": " << r.p50_seconds << ", "
+                << "\"latency_p99_seconds\": " << r.p99_seconds << ", "
+                << "\"events_per_second\": " << r.events_per_second << ", "
+                << "\"images_per_second\": " << r.images_per_second << ", "
+                << "\"tile_skip_fraction\": " << r.tile_skip_fraction << ", "
+                << "\"load_seconds\": " << r.load_seconds << ", "
+                << "\"warmup_seconds\": " << r.warmup_seconds << ", "
+                << "\"peak_rss_kb\": " << r.peak_rss_kb << ", "
+                << "\"rss_delta_kb\": " << r.rss_delta_kb << "}";
+        }
+
+        out << "\n  ],\n  \"tile_checks\": [";
+        for (size_t i = 0; i < tile_checks.size(); ++i)
+        {
+            const TileCheck& c = tile_checks[i];
+            out << (i == 0 ? "" : ",") << "\n    {"
+                << "\"view\": " << c.view << ", "
+                << "\"events\": " << c.stats.n_events << ", "
+                << "\"hits\": " << c.stats.n_hits << ", "
+                << "\"agreement\": " << c.stats.agreement() << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::map<std::string, std::string> args = {
+        {"batch-sizes", "1"}, {"intra-threads", "1"}, {"workers", "1"},
+        {"height", "256"}, {"width", "256"}, {"iterations", "3"}, {"warmup", "2"},
+        {"synthetic-events", "100"}, {"synthetic-hits", "2000"},
+        {"tile-size", "0"}, {"tile-halo", "32"}, {"tile-alignment", "16"}, {"tile-min-agreement", "1"}};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string key = argv[i];
+        if (key.rfind("--", 0) != 0 || i + 1 >= argc)
+        {
+            std::cerr << "Usage: " << argv[0] << " --model-u FILE --model-v FILE --model-w FILE [options]" << std::endl;
+            return 1;
+        }
+        args[key.substr(2)] = argv[++i];
+    }
+
+    try {
+        const int height = std::stoi(args["height"]);
+        const int width = std::stoi(args["width"]);
+
+        std::map<common::PandoraView, std::string> model_paths;
+        for (auto [view, name] : std::vector<std::pair<common::PandoraView, std::string>>{{common::TPC_VIEW_U, "u"}, {common::TPC_VIEW_V, "v"}, {common::TPC_VIEW_W, "w"}})
+        {
+            if (args["model-" + name].empty())
+                throw std::runtime_error("Missing --model-" + name);
+            model_paths[view] = args["model-" + name];
+        }
+
+        network::TileConfig tiles{std::stoi(args["tile-size"]), std::stoi(args["tile-halo"]), std::stoi(args["tile-alignment"])};
+        const std::string tile_error = tiles.check(height, width);
+        if (!tile_error.empty())
+            throw std::runtime_error("Invalid tiling: " + tile_error);
+
+        const bool replay = !args["images-u"].empty() || !args["images-v"].empty() || !args["images-w"].empty();
+
+        ViewImages images;
+        if (replay)
+            images = replayedImages({{common::TPC_VIEW_U, split(args["images-u"])}, {common::TPC_VIEW_V, split(args["images-v"])}, {common::TPC_VIEW_W, split(args["images-w"])}}, height, width);
+        else
+            images = syntheticImages(std::stoul(args["synthetic-events"]), std::stoul(args["synthetic-hits"]), height, width);
+
+        for (auto view : kViews)
+        {
+            if (images[view].empty())
+                throw std::runtime_error("No images for one of the views");
+        }
+
+        const int iterations = std::stoi(args["iterations"]);
+        const int warmup = std::stoi(args["warmup"]);
+
+        std::vector<RunResult> results;
+        for (int batch_size : splitInts(args["batch-sizes"]))
+            for (int intra_threads : splitInts(args["intra-threads"]))
+                for (int workers : splitInts(args["workers"]))
+                    results.push_back(runInChild<RunResult>([&]() {
+                        return runConfiguration(model_paths, images, height, width, batch_size, intra_threads, workers, iterations, warmup, tiles);
+                    }));
+
+        std::vector<TileCheck> tile_checks;
+        bool tiles_agree = true;
+        if (tiles.enabled())
+        {
+            const double min_agreement = std::stod(args["tile-min-agreement"]);
+            const TileChecks checks = runInChild<TileChecks>([&]() { return checkTiling(model_paths, images, tiles); });
+            for (const TileCheck& check : checks.views)
+            {
+                tiles_agree = tiles_agree && check.stats.n_hits > 0 && check.stats.agreement() >= min_agreement;
+                tile_checks.push_back(check);
+            }
+        }
+
+        std::map<std::string, std::string> config = args;
+        config["image_source"] = replay ? "replayed" : "synthetic";
+
+        if (args["output"].empty())
+        {
+            writeJSON(std::cout, config, results, tile_checks);
+        }
+        else
+        {
+            std::ofstream out(args["output"]);
+            writeJSON(out, config, results, tile_checks);
+        }
+
+        if (!tiles_agree)
+        {
+            std::cerr << "inference_benchmark: tiled inference disagrees with full-image inference beyond --tile-min-agreement" << std::endl;
+            return 2;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "inference_benchmark: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
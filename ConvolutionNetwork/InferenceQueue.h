@@ -0,0 +1,439 @@
+#ifndef INFERENCEQUEUE_H
+#define INFERENCEQUEUE_H
+
+#include "CommonFunctions/PandoraView.h"
+#include "ConvolutionNetwork/SparseImage.h"
+
+#ifdef ClassDef
+#undef ClassDef
+#endif
+#include <torch/torch.h>
+#include <torch/script.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace network
+{
+    using Model = std::shared_ptr<torch::jit::script::Module>;
+
+    struct InferenceRequest
+    {
+        int run, subrun, event;
+        common::PandoraView view;
+        SparseImage image;
+        std::vector<size_t> hit_keys;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    struct InferenceResult
+    {
+        int run, subrun, event;
+        common::PandoraView view;
+        int n_classes = 0;
+        std::vector<size_t> hit_keys;
+        std::vector<int> hit_classes;
+        std::vector<float> hit_scores;
+        double latency_seconds = 0.;
+    };
+
+    struct InferenceStats
+    {
+        size_t n_images = 0;
+        size_t n_batches = 0;
+        double forward_seconds = 0.;
+        double total_latency_seconds = 0.;
+        double max_latency_seconds = 0.;
+        size_t n_tiles = 0;
+        size_t n_tiles_run = 0;
+
+        double effectiveBatchSize() const { return n_batches > 0 ? static_cast<double>(n_images) / n_batches : 0.; }
+        double imagesPerSecond() const { return forward_seconds > 0. ? n_images / forward_seconds : 0.; }
+        double meanLatency() const { return n_images > 0 ? total_latency_seconds / n_images : 0.; }
+        double tileSkipFraction() const { return n_tiles > 0 ? 1. - static_cast<double>(n_tiles_run) / n_tiles : 0.; }
+
+        void merge(const InferenceStats& other)
+        {
+            n_images += other.n_images;
+            n_batches += other.n_batches;
+            forward_seconds += other.forward_seconds;
+            total_latency_seconds += other.total_latency_seconds;
+            max_latency_seconds = std::max(max_latency_seconds, other.max_latency_seconds);
+            n_tiles += other.n_tiles;
+            n_tiles_run += other.n_tiles_run;
+        }
+    };
+
+    // Tiled inference splits each image into size x size cores and runs only
+    // the cores holding charge, each inside a window extended by halo pixels
+    // (at least the network's receptive-field radius) on every side. Window
+    // origins are multiples of alignment (the network's total downsampling)
+    // and windows are shifted to stay inside the image, so every core pixel
+    // sees the same input and padding it would see in the full image.
+    struct TileConfig
+    {
+        int size = 0;
+        int halo = 0;
+        int alignment = 1;
+
+        bool enabled() const { return size > 0; }
+        int window() const
+        {
+            const int step = std::max(alignment, 1);
+            return ((size + 2 * halo + step - 1 + step - 1) / step) * step;
+        }
+
+        // Empty if tiles of this configuration fit a height x width image,
+        // otherwise why not: the sides must be multiples of alignment for
+        // window origins to line up with the network's downsampling, and a
+        // window larger than a side would start before the image.
+        std::string check(int height, int width) const
+        {
+            if (size <= 0)
+                return "";
+            if (halo < 0 || alignment < 1)
+                return "TileHalo must be >= 0 and TileAlignment >= 1";
+            if (height % alignment != 0 || width % alignment != 0)
+                return "image " + std::to_string(height) + "x" + std::to_string(width) + " is not a multiple of TileAlignment " + std::to_string(alignment);
+            if (this->window() > std::min(height, width))
+                return "tile window " + std::to_string(this->window()) + " is larger than image " + std::to_string(height) + "x" + std::to_string(width);
+
+            return "";
+        }
+    };
+
+    // Collects sparse network inputs per view until batch_size images are
+    // pending, then scatters them into a reusable dense batch, runs the view's
+    // model once and hands each event's per-hit classes back through the
+    // callback. push and flush may be called from several schedules at once.
+    // Only taking a full batch off the queue is serialised: the forward and
+    // the callback run on the calling thread, each batch in its own dense
+    // buffer from a pool, so the callback must be safe to call concurrently.
+    class InferenceQueue
+    {
+    public:
+        using Callback = std::function<void(InferenceResult&&)>;
+
+        InferenceQueue(std::map<common::PandoraView, Model> models, size_t batch_size, Callback callback, TileConfig tiles = TileConfig())
+            : _models{std::move(models)}
+            , _batch_size{std::max<size_t>(batch_size, 1)}
+            , _callback{std::move(callback)}
+            , _tiles{tiles}
+        {}
+
+        void push(InferenceRequest&& request)
+        {
+            std::vector<InferenceRequest> batch;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                request.enqueued = std::chrono::steady_clock::now();
+                auto& pending = _pending[request.view];
+                pending.push_back(std::move(request));
+                if (pending.size() < _batch_size)
+                    return;
+
+                batch.swap(pending);
+            }
+
+            this->run(batch);
+        }
+
+        void flush()
+        {
+            std::vector<std::vector<InferenceRequest>> batches;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                for (auto& [view, pending] : _pending)
+                {
+                    if (pending.empty())
+                        continue;
+
+                    batches.emplace_back();
+                    batches.back().swap(pending);
+                }
+            }
+
+            for (auto& batch : batches)
+                this->run(batch);
+        }
+
+        InferenceStats stats() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _stats;
+        }
+
+    private:
+        // Dense input buffers, zero outside a running forward. One is taken
+        // from the pool per batch in flight and returned once it is done.
+        struct Workspace
+        {
+            torch::Tensor batch;
+            torch::Tensor tiles;
+        };
+
+        mutable std::mutex _mutex;
+        std::map<common::PandoraView, Model> _models;
+        size_t _batch_size;
+        Callback _callback;
+        TileConfig _tiles;
+        std::map<common::PandoraView, std::vector<InferenceRequest>> _pending;
+        std::vector<std::unique_ptr<Workspace>> _workspaces;
+        InferenceStats _stats;
+
+        std::unique_ptr<Workspace> acquireWorkspace()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_workspaces.empty())
+                return std::make_unique<Workspace>();
+
+            std::unique_ptr<Workspace> workspace = std::move(_workspaces.back());
+            _workspaces.pop_back();
+            return workspace;
+        }
+
+        void releaseWorkspace(std::unique_ptr<Workspace> workspace, const InferenceStats& stats)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _workspaces.push_back(std::move(workspace));
+            _stats.merge(stats);
+        }
+
+        torch::Tensor& batchBuffer(Workspace& workspace, int height, int width)
+        {
+            if (!workspace.batch.defined() || workspace.batch.size(2) != height || workspace.batch.size(3) != width)
+                workspace.batch = torch::zeros({static_cast<int64_t>(_batch_size), 1, height, width});
+
+            return workspace.batch;
+        }
+
+        void run(std::vector<InferenceRequest>& batch)
+        {
+            const int height = batch.front().image.height;
+            const int width = batch.front().image.width;
+
+            if (_tiles.enabled() && _tiles.window() < height && _tiles.window() < width)
+                this->runTiled(batch);
+            else
+                this->runDense(batch);
+        }
+
+        // Gathers the logits of every hit in one index_select from a [C, M]
+        // block, then takes the softmax and argmax over the gathered
+        // [n_hits, C] block only. hit_index holds each hit's column, or -1.
+        void readback(const torch::Tensor& logits, const std::vector<int64_t>& hit_index, InferenceResult& result)
+        {
+            const int64_t n_classes = logits.size(0);
+            const size_t n_hits = hit_index.size();
+
+            result.n_classes = static_cast<int>(n_classes);
+            result.hit_classes.assign(n_hits, -1);
+            result.hit_scores.assign(n_hits * n_classes, 0.f);
+
+            std::vector<int64_t> hits, columns;
+            hits.reserve(n_hits);
+            columns.reserve(n_hits);
+            for (size_t i = 0; i < n_hits; ++i)
+            {
+                if (hit_index[i] < 0)
+                    continue;
+
+                hits.push_back(static_cast<int64_t>(i));
+                columns.push_back(hit_index[i]);
+            }
+
+            if (columns.empty())
+                return;
+
+            torch::Tensor index = torch::from_blob(columns.data(), {static_cast<int64_t>(columns.size())}, torch::kLong);
+            torch::Tensor gathered = logits.index_select(1, index).t();
+            torch::Tensor scores = torch::softmax(gathered, 1).contiguous();
+            torch::Tensor labels = torch::argmax(scores, 1).contiguous();
+
+            const float* scores_data = scores.data<float>();
+            const int64_t* labels_data = labels.data<int64_t>();
+            for (size_t j = 0; j < hits.size(); ++j)
+            {
+                const size_t i = static_cast<size_t>(hits[j]);
+                result.hit_classes[i] = static_cast<int>(labels_data[j]);
+                std::copy(scores_data + j * n_classes, scores_data + (j + 1) * n_classes, result.hit_scores.begin() + i * n_classes);
+            }
+        }
+
+        void finishRequest(InferenceRequest& request, const torch::Tensor& logits, const std::vector<int64_t>& hit_index, std::chrono::steady_clock::time_point finish, InferenceStats& stats)
+        {
+            InferenceResult result;
+            result.run = request.run;
+            result.subrun = request.subrun;
+            result.event = request.event;
+            result.view = request.view;
+            result.hit_keys = std::move(request.hit_keys);
+            result.latency_seconds = std::chrono::duration<double>(finish - request.enqueued).count();
+            if (logits.defined())
+                this->readback(logits, hit_index, result);
+            else
+                result.hit_classes.assign(result.hit_keys.size(), -1);
+
+            stats.total_latency_seconds += result.latency_seconds;
+            stats.max_latency_seconds = std::max(stats.max_latency_seconds, result.latency_seconds);
+
+            _callback(std::move(result));
+        }
+
+        void runDense(std::vector<InferenceRequest>& batch)
+        {
+            const common::PandoraView view = batch.front().view;
+            const int height = batch.front().image.height;
+            const int width = batch.front().image.width;
+            const int64_t n_images = static_cast<int64_t>(batch.size());
+
+            std::unique_ptr<Workspace> workspace = this->acquireWorkspace();
+            torch::Tensor& buffer = this->batchBuffer(*workspace, height, width);
+            float* dense = buffer.data<float>();
+            for (int64_t b = 0; b < n_images; ++b)
+                batch[b].image.scatter(dense + b * height * width);
+
+            torch::NoGradGuard no_grad;
+            auto start = std::chrono::steady_clock::now();
+            torch::Tensor output = _models.at(view)->forward({buffer.narrow(0, 0, n_images)}).toTensor();
+            auto finish = std::chrono::steady_clock::now();
+
+            for (int64_t b = 0; b < n_images; ++b)
+                batch[b].image.erase(dense + b * height * width);
+
+            InferenceStats stats;
+            stats.n_images = batch.size();
+            stats.n_batches = 1;
+            stats.forward_seconds = std::chrono::duration<double>(finish - start).count();
+
+            for (size_t b = 0; b < batch.size(); ++b)
+            {
+                const SparseImage& image = batch[b].image;
+                std::vector<int64_t> hit_index(image.hit_pixel.begin(), image.hit_pixel.end());
+                this->finishRequest(batch[b], output[b].reshape({output.size(1), -1}), hit_index, finish, stats);
+            }
+
+            this->releaseWorkspace(std::move(workspace), stats);
+        }
+
+        int tileOrigin(int core_start, int extent) const
+        {
+            const int step = std::max(_tiles.alignment, 1);
+            const int start = core_start - _tiles.halo;
+            const int aligned = start >= 0 ? (start / step) * step : 0;
+            return std::min(aligned, extent - _tiles.window());
+        }
+
+        // Runs every window holding charge, from all images of the batch, in
+        // one forward and points each hit at its core's pixel in its window.
+        void runTiled(std::vector<InferenceRequest>& batch)
+        {
+            const common::PandoraView view = batch.front().view;
+            const int height = batch.front().image.height;
+            const int width = batch.front().image.width;
+            const int window = _tiles.window();
+            const int n_cores_y = (height + _tiles.size - 1) / _tiles.size;
+            const int n_cores_x = (width + _tiles.size - 1) / _tiles.size;
+
+            InferenceStats stats;
+            std::vector<std::pair<int, int>> origins;
+            std::vector<size_t> first_tile(batch.size());
+            std::vector<std::vector<int64_t>> hit_index(batch.size());
+
+            for (size_t b = 0; b < batch.size(); ++b)
+            {
+                const SparseImage& image = batch[b].image;
+                first_tile[b] = origins.size();
+
+                std::vector<int> core_tile(n_cores_y * n_cores_x, -1);
+                std::map<std::pair<int, int>, int> window_tile;
+                for (int pixel : image.pixels)
+                {
+                    const int core = (pixel / width / _tiles.size) * n_cores_x + (pixel % width) / _tiles.size;
+                    if (core_tile[core] >= 0)
+                        continue;
+
+                    const std::pair<int, int> origin{this->tileOrigin((core / n_cores_x) * _tiles.size, height), this->tileOrigin((core % n_cores_x) * _tiles.size, width)};
+                    auto inserted = window_tile.emplace(origin, static_cast<int>(origins.size()));
+                    if (inserted.second)
+                        origins.push_back(origin);
+                    core_tile[core] = inserted.first->second;
+                }
+
+                stats.n_tiles += n_cores_y * n_cores_x;
+                stats.n_tiles_run += origins.size() - first_tile[b];
+
+                hit_index[b].assign(image.hit_pixel.size(), -1);
+                for (size_t i = 0; i < image.hit_pixel.size(); ++i)
+                {
+                    const int pixel = image.hit_pixel[i];
+                    if (pixel < 0)
+                        continue;
+
+                    const int y = pixel / width;
+                    const int x = pixel % width;
+                    const int tile = core_tile[(y / _tiles.size) * n_cores_x + x / _tiles.size];
+                    hit_index[b][i] = (static_cast<int64_t>(tile) * window + (y - origins[tile].first)) * window + (x - origins[tile].second);
+                }
+            }
+
+            std::unique_ptr<Workspace> workspace = this->acquireWorkspace();
+            auto finish = std::chrono::steady_clock::now();
+            torch::Tensor flat_logits;
+            const int64_t n_tiles = static_cast<int64_t>(origins.size());
+            if (n_tiles > 0)
+            {
+                torch::Tensor& tile_buffer = workspace->tiles;
+                if (!tile_buffer.defined() || tile_buffer.size(0) < n_tiles || tile_buffer.size(2) != window)
+                    tile_buffer = torch::zeros({n_tiles, 1, window, window});
+
+                float* dense = tile_buffer.data<float>();
+                for (size_t b = 0; b < batch.size(); ++b)
+                {
+                    const SparseImage& image = batch[b].image;
+                    const size_t last_tile = b + 1 < batch.size() ? first_tile[b + 1] : origins.size();
+                    for (size_t tile = first_tile[b]; tile < last_tile; ++tile)
+                    {
+                        const auto [origin_y, origin_x] = origins[tile];
+                        float* tile_data = dense + tile * window * window;
+                        for (size_t p = 0; p < image.pixels.size(); ++p)
+                        {
+                            const int y = image.pixels[p] / width - origin_y;
+                            const int x = image.pixels[p] % width - origin_x;
+                            if (y >= 0 && y < window && x >= 0 && x < window)
+                                tile_data[y * window + x] = image.values[p];
+                        }
+                    }
+                }
+
+                torch::NoGradGuard no_grad;
+                torch::Tensor input = tile_buffer.narrow(0, 0, n_tiles);
+                auto start = std::chrono::steady_clock::now();
+                torch::Tensor output = _models.at(view)->forward({input}).toTensor();
+                finish = std::chrono::steady_clock::now();
+
+                input.zero_();
+                flat_logits = output.permute({1, 0, 2, 3}).contiguous().reshape({output.size(1), -1});
+
+                stats.n_batches += 1;
+                stats.forward_seconds += std::chrono::duration<double>(finish - start).count();
+            }
+
+            stats.n_images += batch.size();
+
+            for (size_t b = 0; b < batch.size(); ++b)
+                this->finishRequest(batch[b], flat_logits, hit_index[b], finish, stats);
+
+            this->releaseWorkspace(std::move(workspace), stats);
+        }
+    };
+}
+
+#endif
\ No newline at end of file
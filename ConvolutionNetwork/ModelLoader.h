@@ -0,0 +1,85 @@
+#ifndef MODELLOADER_H
+#define MODELLOADER_H
+
+#include "ConvolutionNetwork/InferenceQueue.h"
+
+#ifdef ClassDef
+#undef ClassDef
+#endif
+#include <torch/torch.h>
+#include <torch/script.h>
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace network
+{
+    struct ModelLoadStats
+    {
+        size_t n_files = 0;
+        double load_seconds = 0.;
+        double warmup_seconds = 0.;
+    };
+
+    // Loads each TorchScript file once, however many views use it, and runs
+    // warm-up forwards so that the graph executor has profiled and optimised
+    // the batch shapes seen in production before the first event. The models
+    // are expected to be exported in eval mode; the libtorch in use has no
+    // freeze or optimize_for_inference passes to apply here.
+    class ModelLoader
+    {
+    public:
+        Model load(const std::string& path)
+        {
+            auto it = _models.find(path);
+            if (it != _models.end())
+                return it->second;
+
+            auto start = std::chrono::steady_clock::now();
+            Model model = torch::jit::load(path);
+            auto finish = std::chrono::steady_clock::now();
+
+            _stats.n_files += 1;
+            _stats.load_seconds += std::chrono::duration<double>(finish - start).count();
+            _models.emplace(path, model);
+
+            return model;
+        }
+
+        // Runs n_iterations forwards of each model on zero inputs of each
+        // given batch size; a model listed more than once is warmed once.
+        void warmUp(const std::vector<Model>& models, int height, int width, const std::vector<int64_t>& batch_sizes, int n_iterations)
+        {
+            torch::NoGradGuard no_grad;
+            auto start = std::chrono::steady_clock::now();
+
+            std::set<const torch::jit::script::Module*> warmed;
+            for (const Model& model : models)
+            {
+                if (!warmed.insert(model.get()).second)
+                    continue;
+
+                for (int64_t batch_size : batch_sizes)
+                {
+                    torch::Tensor input = torch::zeros({batch_size, 1, height, width});
+                    for (int i = 0; i < n_iterations; ++i)
+                        model->forward({input});
+                }
+            }
+
+            auto finish = std::chrono::steady_clock::now();
+            _stats.warmup_seconds += std::chrono::duration<double>(finish - start).count();
+        }
+
+        const ModelLoadStats& stats() const { return _stats; }
+
+    private:
+        std::map<std::string, Model> _models;
+        ModelLoadStats _stats;
+    };
+}
+
+#endif
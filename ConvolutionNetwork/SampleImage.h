@@ -0,0 +1,36 @@
+#ifndef SAMPLEIMAGE_H
+#define SAMPLEIMAGE_H
+
+#include "ConvolutionNetwork/SparseImage.h"
+#include "ConvolutionNetwork/TrainingShardReader.h"
+
+#include <stdexcept>
+#include <vector>
+
+namespace network
+{
+    // Rebuilds the network input of a stored training or calibration sample,
+    // binning its hits inside the sample's own region bounds exactly as
+    // ConvolutionNetworkAlgo::makeNetworkInput does.
+    inline void BuildSampleImage(const TrainingEvent& evt, SparseImageBuilder& builder, int height, int width, SparseImage& image)
+    {
+        if (evt.n_meta < 14)
+            throw std::runtime_error("Sample has no region bounds in its meta block");
+
+        if (static_cast<int>(evt.meta[6]) != height || static_cast<int>(evt.meta[7]) != width)
+            throw std::runtime_error("Sample image size does not match ImageHeight x ImageWidth");
+
+        const size_t stride = evt.hitStride();
+        std::vector<float> x(evt.n_hits), z(evt.n_hits), q(evt.n_hits);
+        for (size_t i = 0; i < evt.n_hits; ++i)
+        {
+            x[i] = evt.hits[i * stride];
+            z[i] = evt.hits[i * stride + 1];
+            q[i] = evt.hits[i * stride + 2];
+        }
+
+        builder.build(x, z, q, evt.meta[10], evt.meta[11], evt.meta[12], evt.meta[13], image);
+    }
+}
+
+#endif
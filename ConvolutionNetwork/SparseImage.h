@@ -0,0 +1,96 @@
+#ifndef SPARSEIMAGE_H
+#define SPARSEIMAGE_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace network
+{
+    // Coordinate-list image of one view. hit_pixel runs parallel to the hits
+    // the image was built from and holds the flat pixel (row * width + col)
+    // of each hit, or -1 if the hit falls outside the image.
+    struct SparseImage
+    {
+        int height = 0;
+        int width = 0;
+        std::vector<int> hit_pixel;
+        std::vector<int> pixels;
+        std::vector<float> values;
+
+        int size() const { return height * width; }
+        float occupancy() const { return this->size() > 0 ? static_cast<float>(pixels.size()) / this->size() : 0.f; }
+
+        void scatter(float* dense) const
+        {
+            for (size_t i = 0; i < pixels.size(); ++i)
+                dense[pixels[i]] = values[i];
+        }
+
+        void erase(float* dense) const
+        {
+            for (int pixel : pixels)
+                dense[pixel] = 0.f;
+        }
+
+        std::vector<float> toDense() const
+        {
+            std::vector<float> dense(this->size(), 0.f);
+            this->scatter(dense.data());
+            return dense;
+        }
+    };
+
+    class SparseImageBuilder
+    {
+    public:
+        SparseImageBuilder(int height, int width)
+            : _height{height}
+            , _width{width}
+            , _slot(static_cast<size_t>(height) * width, -1)
+        {}
+
+        void build(const std::vector<float>& x, const std::vector<float>& z, const std::vector<float>& q,
+                   float x_min, float x_max, float z_min, float z_max, SparseImage& image)
+        {
+            image.height = _height;
+            image.width = _width;
+            image.hit_pixel.assign(x.size(), -1);
+            image.pixels.clear();
+            image.values.clear();
+
+            const double dx = (x_max - x_min) / _width;
+            const double dz = (z_max - z_min) / _height;
+
+            for (size_t i = 0; i < x.size(); ++i)
+            {
+                const int pixel_x{static_cast<int>(std::floor((x[i] - x_min) / dx))};
+                const int pixel_z{static_cast<int>(std::floor((z[i] - z_min) / dz))};
+
+                if (pixel_x < 0 || pixel_x >= _width || pixel_z < 0 || pixel_z >= _height)
+                    continue;
+
+                const int pixel = pixel_z * _width + pixel_x;
+                int& slot = _slot[pixel];
+                if (slot < 0)
+                {
+                    slot = static_cast<int>(image.pixels.size());
+                    image.pixels.push_back(pixel);
+                    image.values.push_back(0.f);
+                }
+
+                image.values[slot] += q[i];
+                image.hit_pixel[i] = pixel;
+            }
+
+            for (int pixel : image.pixels)
+                _slot[pixel] = -1;
+        }
+
+    private:
+        int _height, _width;
+        std::vector<int> _slot;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,92 @@
+#ifndef TRAININGSHARDFORMAT_H
+#define TRAININGSHARDFORMAT_H
+
+#include <cstdint>
+
+// On-disk layout of a training shard:
+//
+//   ShardFileHeader
+//   { ShardChunkHeader, chunk payload (padded to 8 bytes) } x n_chunks
+//   ShardIndexEntry x n_events
+//   ShardFooter
+//
+// An uncompressed chunk payload is a sequence of events, each one the float32
+// meta block written by ConvolutionNetworkAlgo (n_hits, n_flags, n_meta, run,
+// subrun, event, height, width, vertex, bounds, n_flag_words) followed by
+// n_hits records of (x, z, q, flag words...) float32 values. Each flag word
+// packs kFlagBitsPerWord signature flags as an integer value. Samples whose
+// meta block stops before n_flag_words carry n_flags unpacked 0/1 floats.
+// CSV rows follow the same layout.
+
+namespace network
+{
+    constexpr char kShardMagic[8] = {'K', 'S', 'S', 'H', 'A', 'R', 'D', '1'};
+    constexpr uint32_t kShardVersion = 1;
+    constexpr uint32_t kShardAlignment = 8;
+
+    enum ShardCompression : uint32_t
+    {
+        kShardUncompressed = 0,
+        kShardZlib = 1
+    };
+
+    struct ShardFileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t compression;
+        uint32_t n_meta;
+        uint32_t n_flags;
+        uint32_t shard;
+        uint32_t reserved;
+    };
+
+    struct ShardChunkHeader
+    {
+        uint64_t raw_size;
+        uint64_t stored_size;
+        uint32_t n_events;
+        uint32_t reserved;
+    };
+
+    struct ShardIndexEntry
+    {
+        uint64_t chunk_offset;
+        uint64_t event_offset;
+        uint32_t n_hits;
+        int32_t run;
+        int32_t subrun;
+        int32_t event;
+    };
+
+    struct ShardFooter
+    {
+        uint64_t index_offset;
+        uint64_t n_events;
+        uint64_t n_chunks;
+        char magic[8];
+    };
+
+    static_assert(sizeof(ShardFileHeader) == 32, "unexpected shard header padding");
+    static_assert(sizeof(ShardChunkHeader) == 24, "unexpected chunk header padding");
+    static_assert(sizeof(ShardIndexEntry) == 32, "unexpected index entry padding");
+    static_assert(sizeof(ShardFooter) == 32, "unexpected shard footer padding");
+
+    // Few enough bits that a word's integer value survives both float32 and
+    // the default six-digit CSV formatting.
+    constexpr uint32_t kFlagBitsPerWord = 16;
+    constexpr uint32_t kMaxSignatureFlags = 64;
+    constexpr uint32_t kMetaFlagWords = 14;
+
+    constexpr uint32_t flagWords(uint32_t n_flags)
+    {
+        return (n_flags + kFlagBitsPerWord - 1) / kFlagBitsPerWord;
+    }
+
+    constexpr uint64_t shardPadding(uint64_t size)
+    {
+        return (kShardAlignment - size % kShardAlignment) % kShardAlignment;
+    }
+}
+
+#endif
\ No newline at end of file
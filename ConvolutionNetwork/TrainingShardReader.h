@@ -0,0 +1,313 @@
+#ifndef TRAININGSHARDREADER_H
+#define TRAININGSHARDREADER_H
+
+#include "ConvolutionNetwork/TrainingShardFormat.h"
+
+#include <zlib.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Random access to training samples written by ConvolutionNetworkAlgo, either
+// as binary shards or as the original per-view CSV files. Files are memory
+// mapped read-only, so several loader processes reading the same files share
+// the page cache. Events of uncompressed shards are returned as pointers into
+// the mapping; compressed chunks and CSV rows are decoded into a scratch
+// buffer that stays valid until the next call to event().
+
+namespace network
+{
+    struct TrainingEvent
+    {
+        const float* meta;
+        const float* hits;
+        uint32_t n_meta;
+        uint32_t n_hits;
+        uint32_t n_flags;
+        uint32_t n_flag_words;
+        int32_t run;
+        int32_t subrun;
+        int32_t event;
+        bool zero_copy;
+
+        size_t hitStride() const { return 3 + (n_meta > kMetaFlagWords ? n_flag_words : n_flags); }
+    };
+
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string& path)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("Could not open " + path);
+
+            struct stat st;
+            if (::fstat(fd, &st) != 0) {
+                ::close(fd);
+                throw std::runtime_error("Could not stat " + path);
+            }
+
+            _size = static_cast<size_t>(st.st_size);
+            if (_size > 0) {
+                void* addr = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+                if (addr == MAP_FAILED) {
+                    ::close(fd);
+                    throw std::runtime_error("Could not map " + path);
+                }
+
+                ::madvise(addr, _size, MADV_RANDOM);
+                _data = static_cast<const char*>(addr);
+            }
+
+            ::close(fd);
+        }
+
+        MappedFile(MappedFile const&) = delete;
+        MappedFile& operator=(MappedFile const&) = delete;
+
+        ~MappedFile()
+        {
+            if (_data != nullptr)
+                ::munmap(const_cast<char*>(_data), _size);
+        }
+
+        const char* data() const { return _data; }
+        size_t size() const { return _size; }
+
+    private:
+        const char* _data = nullptr;
+        size_t _size = 0;
+    };
+
+    class TrainingShardReader
+    {
+    public:
+        explicit TrainingShardReader(const std::vector<std::string>& paths)
+        {
+            for (const auto& path : paths)
+            {
+                auto file = std::make_unique<SourceFile>();
+                file->path = path;
+                file->map = std::make_unique<MappedFile>(path);
+
+                if (this->isShard(*file->map))
+                    this->loadShardIndex(*file);
+                else
+                    this->loadLineIndex(*file);
+
+                _files.push_back(std::move(file));
+            }
+        }
+
+        size_t size() const { return _events.size(); }
+
+        TrainingEvent event(size_t i)
+        {
+            if (i >= _events.size())
+                throw std::out_of_range("Training event index out of range");
+
+            const EventRef& ref = _events[i];
+            SourceFile& file = *_files[ref.file];
+
+            if (file.is_shard)
+                return this->shardEvent(file, ref.entry);
+
+            return this->csvEvent(file, ref.entry);
+        }
+
+    private:
+        struct SourceFile
+        {
+            std::string path;
+            std::unique_ptr<MappedFile> map;
+            bool is_shard = false;
+            ShardFileHeader header;
+            std::vector<ShardIndexEntry> index;
+            std::vector<uint64_t> line_offsets;
+        };
+
+        struct EventRef
+        {
+            uint32_t file;
+            uint64_t entry;
+        };
+
+        std::vector<std::unique_ptr<SourceFile>> _files;
+        std::vector<EventRef> _events;
+
+        std::vector<float> _scratch;
+        const SourceFile* _cached_file = nullptr;
+        uint64_t _cached_chunk = 0;
+
+        static bool isShard(const MappedFile& map)
+        {
+            return map.size() >= sizeof(ShardFileHeader) + sizeof(ShardFooter) && std::memcmp(map.data(), kShardMagic, sizeof(kShardMagic)) == 0;
+        }
+
+        void loadShardIndex(SourceFile& file)
+        {
+            const MappedFile& map = *file.map;
+            file.is_shard = true;
+            std::memcpy(&file.header, map.data(), sizeof(ShardFileHeader));
+            if (file.header.version != kShardVersion)
+                throw std::runtime_error("Unsupported shard version in " + file.path);
+
+            ShardFooter footer;
+            std::memcpy(&footer, map.data() + map.size() - sizeof(ShardFooter), sizeof(ShardFooter));
+            if (std::memcmp(footer.magic, kShardMagic, sizeof(kShardMagic)) != 0)
+                throw std::runtime_error("Truncated shard (no footer) " + file.path);
+
+            if (footer.index_offset + footer.n_events * sizeof(ShardIndexEntry) + sizeof(ShardFooter) != map.size())
+                throw std::runtime_error("Corrupt shard index in " + file.path);
+
+            file.index.resize(footer.n_events);
+            std::memcpy(file.index.data(), map.data() + footer.index_offset, footer.n_events * sizeof(ShardIndexEntry));
+
+            for (uint64_t i = 0; i < footer.n_events; ++i)
+                _events.push_back({static_cast<uint32_t>(_files.size()), i});
+        }
+
+        void loadLineIndex(SourceFile& file)
+        {
+            const MappedFile& map = *file.map;
+            const std::string index_path = file.path + ".idx";
+
+            if (!this->readLineIndex(index_path, map.size(), file.line_offsets))
+            {
+                file.line_offsets.clear();
+                const char* begin = map.data();
+                const char* end = begin + map.size();
+                const char* line = begin;
+                while (line < end)
+                {
+                    const char* eol = static_cast<const char*>(std::memchr(line, '\n', end - line));
+                    if (eol == nullptr)
+                        eol = end;
+                    if (eol > line)
+                        file.line_offsets.push_back(line - begin);
+                    line = eol + 1;
+                }
+
+                this->writeLineIndex(index_path, map.size(), file.line_offsets);
+            }
+
+            for (uint64_t i = 0; i < file.line_offsets.size(); ++i)
+                _events.push_back({static_cast<uint32_t>(_files.size()), i});
+        }
+
+        static bool readLineIndex(const std::string& path, uint64_t file_size, std::vector<uint64_t>& offsets)
+        {
+            std::FILE* in = std::fopen(path.c_str(), "rb");
+            if (in == nullptr)
+                return false;
+
+            uint64_t header[2] = {0, 0};
+            bool valid = std::fread(header, sizeof(header), 1, in) == 1 && header[0] == file_size;
+            if (valid) {
+                offsets.resize(header[1]);
+                valid = std::fread(offsets.data(), sizeof(uint64_t), offsets.size(), in) == offsets.size();
+            }
+
+            std::fclose(in);
+            return valid;
+        }
+
+        static void writeLineIndex(const std::string& path, uint64_t file_size, const std::vector<uint64_t>& offsets)
+        {
+            std::FILE* out = std::fopen(path.c_str(), "wb");
+            if (out == nullptr)
+                return;
+
+            const uint64_t header[2] = {file_size, offsets.size()};
+            std::fwrite(header, sizeof(header), 1, out);
+            std::fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), out);
+            std::fclose(out);
+        }
+
+        TrainingEvent shardEvent(SourceFile& file, uint64_t entry)
+        {
+            const ShardIndexEntry& index = file.index[entry];
+            const char* chunk = file.map->data() + index.chunk_offset;
+
+            ShardChunkHeader chunk_header;
+            std::memcpy(&chunk_header, chunk, sizeof(ShardChunkHeader));
+            const char* payload = chunk + sizeof(ShardChunkHeader);
+
+            bool zero_copy = file.header.compression == kShardUncompressed;
+            if (!zero_copy && (_cached_file != &file || _cached_chunk != index.chunk_offset))
+            {
+                _scratch.resize(chunk_header.raw_size / sizeof(float));
+                uLongf raw_size = chunk_header.raw_size;
+                if (uncompress(reinterpret_cast<Bytef*>(_scratch.data()), &raw_size, reinterpret_cast<const Bytef*>(payload), chunk_header.stored_size) != Z_OK)
+                    throw std::runtime_error("Failed to decompress chunk in " + file.path);
+
+                _cached_file = &file;
+                _cached_chunk = index.chunk_offset;
+            }
+
+            const float* meta = zero_copy ? reinterpret_cast<const float*>(payload + index.event_offset) : _scratch.data() + index.event_offset / sizeof(float);
+            return this->makeEvent(meta, zero_copy);
+        }
+
+        TrainingEvent csvEvent(SourceFile& file, uint64_t entry)
+        {
+            const char* begin = file.map->data();
+            const char* line = begin + file.line_offsets[entry];
+            const char* end = entry + 1 < file.line_offsets.size() ? begin + file.line_offsets[entry + 1] : begin + file.map->size();
+
+            std::string row(line, end);
+            _scratch.clear();
+            _cached_file = nullptr;
+
+            char* cursor = &row[0];
+            char* row_end = cursor + row.size();
+            while (cursor < row_end && *cursor != '\n')
+            {
+                char* next = nullptr;
+                float value = std::strtof(cursor, &next);
+                if (next == cursor)
+                    break;
+                _scratch.push_back(value);
+                cursor = (*next == ',') ? next + 1 : next;
+            }
+
+            if (_scratch.size() < 6)
+                throw std::runtime_error("Malformed training row in " + file.path);
+
+            TrainingEvent evt = this->makeEvent(_scratch.data(), false);
+            if (_scratch.size() < evt.n_meta + static_cast<size_t>(evt.n_hits) * evt.hitStride())
+                throw std::runtime_error("Truncated training row in " + file.path);
+
+            return evt;
+        }
+
+        static TrainingEvent makeEvent(const float* meta, bool zero_copy)
+        {
+            TrainingEvent evt;
+            evt.meta = meta;
+            evt.n_hits = static_cast<uint32_t>(meta[0]);
+            evt.n_flags = static_cast<uint32_t>(meta[1]);
+            evt.n_meta = static_cast<uint32_t>(meta[2]);
+            evt.n_flag_words = evt.n_meta > kMetaFlagWords ? static_cast<uint32_t>(meta[kMetaFlagWords]) : 0;
+            evt.run = static_cast<int32_t>(meta[3]);
+            evt.subrun = static_cast<int32_t>(meta[4]);
+            evt.event = static_cast<int32_t>(meta[5]);
+            evt.hits = meta + evt.n_meta;
+            evt.zero_copy = zero_copy;
+            return evt;
+        }
+    };
+}
+
+#endif
\ No newline at end of file
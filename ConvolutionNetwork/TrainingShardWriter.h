@@ -0,0 +1,197 @@
+#ifndef TRAININGSHARDWRITER_H
+#define TRAININGSHARDWRITER_H
+
+#include "cetlib_except/exception.h"
+#include "ConvolutionNetwork/TrainingShardFormat.h"
+
+#include <zlib.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace network
+{
+    class TrainingShardWriter
+    {
+    public:
+        TrainingShardWriter(const std::string& prefix, int compression_level, size_t chunk_bytes, size_t events_per_shard)
+            : _prefix{prefix}
+            , _compression_level{compression_level}
+            , _chunk_bytes{chunk_bytes}
+            , _events_per_shard{events_per_shard}
+        {}
+
+        TrainingShardWriter(TrainingShardWriter const&) = delete;
+        TrainingShardWriter& operator=(TrainingShardWriter const&) = delete;
+
+        ~TrainingShardWriter()
+        {
+            try {
+                this->close();
+            } catch (...) {}
+        }
+
+        void write(const std::vector<float>& feat_vec)
+        {
+            if (feat_vec.size() < 6)
+                throw cet::exception("TrainingShardWriter") << "Feature vector is missing its meta block";
+
+            if (_file == nullptr)
+                this->openShard(static_cast<uint32_t>(feat_vec[2]), static_cast<uint32_t>(feat_vec[1]));
+
+            ShardIndexEntry entry;
+            entry.chunk_offset = 0;
+            entry.event_offset = _chunk.size() * sizeof(float);
+            entry.n_hits = static_cast<uint32_t>(feat_vec[0]);
+            entry.run = static_cast<int32_t>(feat_vec[3]);
+            entry.subrun = static_cast<int32_t>(feat_vec[4]);
+            entry.event = static_cast<int32_t>(feat_vec[5]);
+            _pending.push_back(entry);
+
+            _chunk.insert(_chunk.end(), feat_vec.begin(), feat_vec.end());
+            ++_n_written;
+
+            if (_chunk.size() * sizeof(float) >= _chunk_bytes)
+                this->flushChunk();
+
+            if (_events_per_shard > 0 && _index.size() + _pending.size() >= _events_per_shard)
+                this->closeShard();
+        }
+
+        void close()
+        {
+            if (_file != nullptr)
+                this->closeShard();
+        }
+
+        size_t eventsWritten() const { return _n_written; }
+        size_t bytesWritten() const { return _n_bytes; }
+        unsigned int shardsWritten() const { return _shard; }
+
+    private:
+        std::string _prefix;
+        int _compression_level;
+        size_t _chunk_bytes;
+        size_t _events_per_shard;
+
+        std::FILE* _file = nullptr;
+        uint64_t _offset = 0;
+        uint64_t _n_chunks = 0;
+        unsigned int _shard = 0;
+        size_t _n_written = 0;
+        size_t _n_bytes = 0;
+
+        std::vector<float> _chunk;
+        std::vector<unsigned char> _compressed;
+        std::vector<ShardIndexEntry> _pending;
+        std::vector<ShardIndexEntry> _index;
+
+        void put(const void* data, size_t size)
+        {
+            if (size == 0)
+                return;
+
+            if (std::fwrite(data, 1, size, _file) != size)
+                throw cet::exception("TrainingShardWriter") << "Failed writing shard " << this->shardName(_shard);
+
+            _offset += size;
+            _n_bytes += size;
+        }
+
+        std::string shardName(unsigned int shard) const
+        {
+            char suffix[16];
+            std::snprintf(suffix, sizeof(suffix), "_%04u.bin", shard);
+            return _prefix + suffix;
+        }
+
+        void openShard(uint32_t n_meta, uint32_t n_flags)
+        {
+            const std::string filename = this->shardName(_shard);
+            _file = std::fopen(filename.c_str(), "wb");
+            if (_file == nullptr)
+                throw cet::exception("TrainingShardWriter") << "Could not open shard " << filename;
+
+            _offset = 0;
+            _n_chunks = 0;
+            _index.clear();
+
+            ShardFileHeader header;
+            std::memcpy(header.magic, kShardMagic, sizeof(header.magic));
+            header.version = kShardVersion;
+            header.compression = _compression_level > 0 ? kShardZlib : kShardUncompressed;
+            header.n_meta = n_meta;
+            header.n_flags = n_flags;
+            header.shard = _shard;
+            header.reserved = 0;
+            this->put(&header, sizeof(header));
+        }
+
+        void flushChunk()
+        {
+            if (_pending.empty())
+                return;
+
+            const unsigned char* payload = reinterpret_cast<const unsigned char*>(_chunk.data());
+            const uLong raw_size = _chunk.size() * sizeof(float);
+            uLong stored_size = raw_size;
+
+            if (_compression_level > 0)
+            {
+                uLongf bound = compressBound(raw_size);
+                _compressed.resize(bound);
+                if (compress2(_compressed.data(), &bound, payload, raw_size, _compression_level) != Z_OK)
+                    throw cet::exception("TrainingShardWriter") << "zlib compression failed for shard " << this->shardName(_shard);
+
+                payload = _compressed.data();
+                stored_size = bound;
+            }
+
+            ShardChunkHeader chunk_header;
+            chunk_header.raw_size = raw_size;
+            chunk_header.stored_size = stored_size;
+            chunk_header.n_events = static_cast<uint32_t>(_pending.size());
+            chunk_header.reserved = 0;
+
+            const uint64_t chunk_offset = _offset;
+            this->put(&chunk_header, sizeof(chunk_header));
+            this->put(payload, stored_size);
+
+            const uint64_t zeros = 0;
+            this->put(&zeros, shardPadding(stored_size));
+
+            for (auto& entry : _pending)
+            {
+                entry.chunk_offset = chunk_offset;
+                _index.push_back(entry);
+            }
+
+            ++_n_chunks;
+            _pending.clear();
+            _chunk.clear();
+        }
+
+        void closeShard()
+        {
+            this->flushChunk();
+
+            ShardFooter footer;
+            footer.index_offset = _offset;
+            footer.n_events = _index.size();
+            footer.n_chunks = _n_chunks;
+            std::memcpy(footer.magic, kShardMagic, sizeof(footer.magic));
+
+            this->put(_index.data(), _index.size() * sizeof(ShardIndexEntry));
+            this->put(&footer, sizeof(footer));
+
+            std::fclose(_file);
+            _file = nullptr;
+            _index.clear();
+            ++_shard;
+        }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -1,8 +1,10 @@
-#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Core/SharedAnalyzer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Run.h"
 #include "art/Framework/Principal/Handle.h"
 
+#include "art/Utilities/PerScheduleContainer.h"
 #include "canvas/Persistency/Common/FindManyP.h"
 
 #include "lardataobj/AnalysisBase/BackTrackerMatchingData.h"
@@ -21,11 +23,24 @@
 #include "CommonFunctions/Corrections.h"
 #include "CommonFunctions/Region.h"
 #include "CommonFunctions/Types.h"
+#include "CommonFunctions/HitTable.h"
+
+#include "Services/BadChannelService.h"
 
 #include "art/Utilities/ToolMacros.h"
 #include "art/Utilities/make_tool.h"
 
 #include "SignatureTools/SignatureToolBase.h"
+#include "SignatureTools/SignatureIndex.h"
+#include "SignatureTools/PatternSource.h"
+
+#include "ConvolutionNetwork/TrainingShardWriter.h"
+#include "ConvolutionNetwork/InferenceQueue.h"
+#include "ConvolutionNetwork/ModelLoader.h"
+#include "ConvolutionNetwork/AccuracyGate.h"
+#include "ConvolutionNetwork/TrainingShardReader.h"
+#include "ConvolutionNetwork/SampleImage.h"
+#include "ConvolutionNetwork/SparseImage.h"
 
 #include "TDatabasePDG.h"
 
@@ -42,8 +57,9 @@
 #include <iostream>
 #include <unordered_map>
 #include <cmath>
+#include <mutex>
 
-class ConvolutionNetworkAlgo : public art::EDAnalyzer 
+class ConvolutionNetworkAlgo : public art::SharedAnalyzer 
 {
 public:
     explicit ConvolutionNetworkAlgo(fhicl::ParameterSet const& pset);
@@ -53,18 +69,43 @@ public:
     ConvolutionNetworkAlgo& operator=(ConvolutionNetworkAlgo const&) = delete;
     ConvolutionNetworkAlgo& operator=(ConvolutionNetworkAlgo&&) = delete;
 
-    void analyze(art::Event const& e) override;
-    void beginJob() override;
-    void endJob() override;
-
-    void infer(art::Event const& evt, std::map<int, std::vector<art::Ptr<recob::Hit>>>& classified_hits);
+    void analyze(art::Event const& e, art::ProcessingFrame const& frame) override;
+    void beginJob(art::ProcessingFrame const& frame) override;
+    void beginRun(art::Run const& run, art::ProcessingFrame const& frame) override;
+    void endJob(art::ProcessingFrame const& frame) override;
 
 private:
+    // Everything derived from a single event lives here rather than in
+    // members, so that several schedules can run the module at once.
+    struct EventContext
+    {
+        std::map<common::PandoraView, std::array<float, 4>> region_bounds;
+        common::HitTable hit_table;
+        std::vector<size_t> region_hits;
+        std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>> mcp_bkth_assoc;
+    };
+
     bool _training_mode;
     int _pass;
     
     std::string _training_output_file;
+    std::string _training_output_format;
+    int _shard_compression_level;
+    size_t _shard_chunk_size;
+    size_t _shard_max_events;
+    std::map<common::PandoraView, std::unique_ptr<network::TrainingShardWriter>> _shard_writers;
+    std::mutex _output_mutex;
+
     std::shared_ptr<torch::jit::script::Module> _model_u, _model_v, _model_w;
+    size_t _inference_batch_size;
+    int _model_warmup_iterations;
+    network::TileConfig _tile_config;
+
+    std::string _calibration_output_file;
+    size_t _calibration_events;
+    std::map<common::PandoraView, std::unique_ptr<network::TrainingShardWriter>> _calibration_writers;
+    std::unique_ptr<network::InferenceQueue> _inference_queue;
+    art::PerScheduleContainer<std::unique_ptr<network::SparseImageBuilder>> _image_builders;
 
     int _width, _height;
 
@@ -74,35 +115,40 @@ private:
 
     art::InputTag _HitProducer, _MCPproducer, _MCTproducer, _BacktrackTag, _PFPproducer, _CLSproducer, _SHRproducer, _SLCproducer, _VTXproducer, _PCAproducer, _TRKproducer;
 
-    std::map<common::PandoraView, std::array<float, 4>> _region_bounds;
-    std::vector<art::Ptr<recob::Hit>> _region_hits;
-    std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>> _mcp_bkth_assoc;
-
     calo::CalorimetryAlg* _calo_alg;
 
-    std::vector<std::unique_ptr<::signature::SignatureToolBase>> _signatureToolsVec;
+    std::unique_ptr<::signature::PatternSource> _pattern_source;
 
-    std::string _bad_channel_file;
     bool _veto_bad_channels;
-    std::vector<bool> _bad_channel_mask;
-    const geo::GeometryCore* _geo;
 
-    void initialiseEvent(art::Event const& evt);
-    void initialiseBadChannelMask();
-    void prepareTrainingSample(art::Event const& evt);
+    void initialiseEvent(art::Event const& evt, EventContext& ctx) const;
+    void prepareTrainingSample(art::Event const& evt, const EventContext& ctx);
+    void infer(art::Event const& evt, const EventContext& ctx, network::SparseImageBuilder& builder);
+    void checkTiling(fhicl::ParameterSet const& pset, const std::map<common::PandoraView, network::Model>& models) const;
+    void produceCalibrationSample(art::Event const& evt, const EventContext& ctx, const common::PandoraView view, const std::vector<size_t>& hit_list);
+    void handleInferenceResult(network::InferenceResult&& result);
     void produceTrainingSample(const std::string& filename, const std::vector<float>& feat_vec, bool result);
-    void makeNetworkInput(const art::Event& evt, const std::vector<art::Ptr<recob::Hit>>& hit_list, const common::PandoraView view, torch::Tensor& network_input, std::map<art::Ptr<recob::Hit>,std::pair<int, int>>& calohit_pixel_map);
-    void findRegionBounds(art::Event const& evt, const std::vector<art::Ptr<recob::Hit>>& hits);
-    void getNuVertex(art::Event const& evt, std::array<float, 3>& nu_vtx, bool& found_vertex);
-    void calculateChargeCentroid(const art::Event& evt, const std::vector<art::Ptr<recob::Hit>>& hits, std::map<common::PandoraView, std::array<float, 2>>& q_cent_map, std::map<common::PandoraView, float>& tot_q_map);
-    std::tuple<float, float, float, float> getBoundsForView(common::PandoraView view) const;
+    void makeNetworkInput(const EventContext& ctx, network::SparseImageBuilder& builder, const std::vector<size_t>& hit_list, const common::PandoraView view, network::SparseImage& image) const;
+    void findRegionBounds(EventContext& ctx, const std::vector<size_t>& hits) const;
+    void getNuVertex(art::Event const& evt, std::array<float, 3>& nu_vtx, bool& found_vertex) const;
+    void calculateChargeCentroid(const EventContext& ctx, const std::vector<size_t>& hits, std::map<common::PandoraView, std::array<float, 2>>& q_cent_map, std::map<common::PandoraView, float>& tot_q_map) const;
+    std::tuple<float, float, float, float> getBoundsForView(const EventContext& ctx, common::PandoraView view) const;
 };
 
 ConvolutionNetworkAlgo::ConvolutionNetworkAlgo(fhicl::ParameterSet const& pset)
-    : EDAnalyzer{pset}
+    : SharedAnalyzer{pset}
     , _training_mode{pset.get<bool>("TrainingMode", true)}
     , _pass{pset.get<int>("Pass", 1)}
     , _training_output_file{pset.get<std::string>("TrainingOutputFile", "training_output")}
+    , _training_output_format{pset.get<std::string>("TrainingOutputFormat", "csv")}
+    , _shard_compression_level{pset.get<int>("ShardCompressionLevel", 0)}
+    , _shard_chunk_size{pset.get<size_t>("ShardChunkSize", 4 << 20)}
+    , _shard_max_events{pset.get<size_t>("ShardMaxEvents", 10000)}
+    , _inference_batch_size{pset.get<size_t>("InferenceBatchSize", 1)}
+    , _model_warmup_iterations{pset.get<int>("ModelWarmUpIterations", 2)}
+    , _tile_config{pset.get<int>("TileSize", 0), pset.get<int>("TileHalo", 32), pset.get<int>("TileAlignment", 16)}
+    , _calibration_output_file{pset.get<std::string>("CalibrationOutputFile", "")}
+    , _calibration_events{pset.get<size_t>("CalibrationEvents", 0)}
     , _width{pset.get<int>("ImageWidth", 256)}
     , _height{pset.get<int>("ImageHeight", 256)}
     , _drift_step{pset.get<float>("DriftStep", 0.5)}
@@ -120,23 +166,50 @@ ConvolutionNetworkAlgo::ConvolutionNetworkAlgo(fhicl::ParameterSet const& pset)
     , _VTXproducer{pset.get<art::InputTag>("VTXproducer", "pandora")}
     , _PCAproducer{pset.get<art::InputTag>("PCAproducer", "pandora")}
     , _TRKproducer{pset.get<art::InputTag>("TRKproducer", "pandora")}
-    , _bad_channel_file{pset.get<std::string>("BadChannelFile", "badchannels.txt")}
     , _veto_bad_channels{pset.get<bool>("VetoBadChannels", true)}
 {
+    const std::string tile_error = _tile_config.check(_height, _width);
+    if (!tile_error.empty())
+        throw cet::exception("ConvolutionNetworkAlgo") << "Invalid tiling: " << tile_error;
+
     try {
         if (!_training_mode) 
         {
             std::cout << "In testing mode!" << std::endl;
             std::cout << pset.get<std::string>("ModelFileU") << std::endl;
-            _model_u = torch::jit::load(pset.get<std::string>("ModelFileU"));
-            _model_v = torch::jit::load(pset.get<std::string>("ModelFileV"));
-            _model_w = torch::jit::load(pset.get<std::string>("ModelFileW"));
-            std::cout << "Loaded models" << std::endl;
+
+            network::ModelLoader loader;
+            _model_u = loader.load(pset.get<std::string>("ModelFileU"));
+            _model_v = loader.load(pset.get<std::string>("ModelFileV"));
+            _model_w = loader.load(pset.get<std::string>("ModelFileW"));
+
+            std::map<common::PandoraView, network::Model> models{{common::TPC_VIEW_U, _model_u}, {common::TPC_VIEW_V, _model_v}, {common::TPC_VIEW_W, _model_w}};
+
+            std::vector<int64_t> warmup_batches = {static_cast<int64_t>(_inference_batch_size)};
+            if (_inference_batch_size > 1)
+                warmup_batches.push_back(1);
+            loader.warmUp({models.at(common::TPC_VIEW_U), models.at(common::TPC_VIEW_V), models.at(common::TPC_VIEW_W)}, _height, _width, warmup_batches, _model_warmup_iterations);
+
+            if (_tile_config.enabled())
+                this->checkTiling(pset, models);
+
+            const auto& load_stats = loader.stats();
+            mf::LogInfo("ConvolutionNetworkAlgo") << "Loaded " << load_stats.n_files << " model files in " << load_stats.load_seconds << " s"
+                << ", warm-up of " << _model_warmup_iterations << " iterations took " << load_stats.warmup_seconds << " s";
+
+            _inference_queue = std::make_unique<network::InferenceQueue>(
+                std::move(models),
+                _inference_batch_size, 
+                [this](network::InferenceResult&& result) { this->handleInferenceResult(std::move(result)); },
+                _tile_config);
         }
     } catch (const c10::Error& e) {
         throw cet::exception("ConvolutionNetworkAlgo") << "Error loading Torch models: " << e.what() << "\n";
     }
 
+    if (_training_output_format != "csv" && _training_output_format != "shards")
+        throw cet::exception("ConvolutionNetworkAlgo") << "Unknown TrainingOutputFormat: " << _training_output_format;
+
     _calo_alg = new calo::CalorimetryAlg(pset.get<fhicl::ParameterSet>("CaloAlg"));
 
     _wire_pitch = {
@@ -145,126 +218,95 @@ ConvolutionNetworkAlgo::ConvolutionNetworkAlgo(fhicl::ParameterSet const& pset)
         {common::TPC_VIEW_W, _wire_pitch_w}
     };
 
-    const fhicl::ParameterSet &tool_psets = pset.get<fhicl::ParameterSet>("SignatureTools");
-    for (auto const &tool_pset_label : tool_psets.get_pset_names())
-    {
-        auto const tool_pset = tool_psets.get<fhicl::ParameterSet>(tool_pset_label);
-        _signatureToolsVec.push_back(art::make_tool<::signature::SignatureToolBase>(tool_pset));
-    }
-
-    _geo = art::ServiceHandle<geo::Geometry>()->provider();
-    size_t num_channels = _geo->Nchannels();
-    _bad_channel_mask.resize(num_channels, false);
+    _pattern_source = std::make_unique<::signature::PatternSource>(pset);
+    _image_builders.expand_to_num_schedules();
+    if (_pattern_source->size() > signature::SignatureIndex::kMaxSignatures)
+        throw cet::exception("ConvolutionNetworkAlgo") << "At most " << signature::SignatureIndex::kMaxSignatures << " signature tools are supported";
 
-    if (_veto_bad_channels)
-        this->initialiseBadChannelMask();
+    serialize<art::InEvent>();
 }
 
-void ConvolutionNetworkAlgo::analyze(art::Event const& evt) 
+void ConvolutionNetworkAlgo::analyze(art::Event const& evt, art::ProcessingFrame const& frame) 
 {   
-    this->initialiseEvent(evt); 
-    if (_region_hits.empty())
+    EventContext ctx;
+    this->initialiseEvent(evt, ctx); 
+    if (ctx.region_hits.empty())
         return;
 
     try {
         if (_training_mode)
-            this->prepareTrainingSample(evt);
+            this->prepareTrainingSample(evt, ctx);
+        else
+        {
+            auto& builder = _image_builders[frame.scheduleID()];
+            if (!builder)
+                builder = std::make_unique<network::SparseImageBuilder>(_height, _width);
+
+            this->infer(evt, ctx, *builder);
+        }
     } catch (const c10::Error& e) {
         throw cet::exception("ConvolutionNetworkAlgo") << "Error running algorithm: " << e.what() << "\n";
     }
 }
 
-void ConvolutionNetworkAlgo::initialiseEvent(art::Event const& evt)
+void ConvolutionNetworkAlgo::initialiseEvent(art::Event const& evt, EventContext& ctx) const
 {
-    _region_bounds.clear();
-    _region_hits.clear(); 
-    _mcp_bkth_assoc.reset();
-
-    std::vector<art::Ptr<recob::Hit>> evt_hits, all_hits, sim_hits;
+    std::vector<art::Ptr<recob::Hit>> evt_hits;
+    std::vector<size_t> sim_hits;
     art::Handle<std::vector<recob::Hit>> hit_handle;
     
     if (evt.getByLabel(_HitProducer, hit_handle))
     {
         art::fill_ptr_vector(evt_hits, hit_handle);
-        _mcp_bkth_assoc = std::make_unique<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>>(hit_handle, evt, _BacktrackTag);
+        ctx.mcp_bkth_assoc = std::make_unique<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>>(hit_handle, evt, _BacktrackTag);
+        common::BuildHitTable(evt, evt_hits, *_calo_alg, art::ServiceHandle<BadChannelService>()->mask(), ctx.hit_table);
 
-        for (const auto& hit : evt_hits) 
+        for (size_t i = 0; i < ctx.hit_table.size(); ++i) 
         {
-            if (_veto_bad_channels && _bad_channel_mask[hit->Channel()]) 
+            if (_veto_bad_channels && ctx.hit_table.bad_channel[i]) 
                 continue;
-            
-            all_hits.push_back(hit);
 
-            auto assmcp = _mcp_bkth_assoc->at(hit.key());
-            auto assmdt = _mcp_bkth_assoc->data(hit.key());
-            for (unsigned int ia = 0; ia < assmcp.size(); ++ia)
+            auto assmdt = ctx.mcp_bkth_assoc->data(ctx.hit_table.key[i]);
+            for (unsigned int ia = 0; ia < assmdt.size(); ++ia)
             {
                 auto amd = assmdt[ia];
                 if (amd->isMaxIDE != 1)
                     continue;
                 
-                sim_hits.push_back(hit);
+                sim_hits.push_back(i);
             }
         }
     }
 
-    if (sim_hits.empty() || all_hits.empty()) 
+    if (sim_hits.empty()) 
         return;
 
     mf::LogInfo("ConvolutionNetworkAlgo") << "Input Hit size: " << sim_hits.size();
 
-    this->findRegionBounds(evt, sim_hits);
-    if (_region_bounds.empty())
+    this->findRegionBounds(ctx, sim_hits);
+    if (ctx.region_bounds.empty())
         return;
 
-    for (const auto& hit : sim_hits)
+    for (size_t i : sim_hits)
     {
-        common::PandoraView view = common::GetPandoraView(hit);
-        auto [drift_min, drift_max, wire_min, wire_max] = this->getBoundsForView(view);
+        auto [drift_min, drift_max, wire_min, wire_max] = this->getBoundsForView(ctx, ctx.hit_table.view[i]);
 
-        const auto pos = common::GetPandoraHitPosition(evt, hit, view);
-        float x = pos.X();
-        float z = pos.Z();
+        float x = ctx.hit_table.drift[i];
+        float z = ctx.hit_table.wire[i];
 
         if (x >= drift_min && x <= drift_max && z >= wire_min && z <= wire_max)
-            _region_hits.push_back(hit);
+            ctx.region_hits.push_back(i);
     }
 
-    mf::LogInfo("ConvolutionNetworkAlgo") << "Region Hit size: " << _region_hits.size();
-}
-
-void ConvolutionNetworkAlgo::initialiseBadChannelMask()
-{
-    if (!_bad_channel_file.empty()) {
-        cet::search_path sp("FW_SEARCH_PATH");
-        std::string fullname;
-        sp.find_file(_bad_channel_file, fullname);
-        if (fullname.empty()) {
-            throw cet::exception("ConvolutionNetworkAlgo") << "Bad channel file not found: " << _bad_channel_file;
-        }
-
-        std::ifstream inFile(fullname, std::ios::in);
-        std::string line;
-        while (std::getline(inFile, line)) {
-            if (line.find("#") != std::string::npos) continue;
-            std::istringstream ss(line);
-            int ch1, ch2;
-            ss >> ch1;
-            if (!(ss >> ch2)) ch2 = ch1;
-            for (int i = ch1; i <= ch2; ++i) {
-                _bad_channel_mask[i] = true;
-            }
-        }
-        std::cout << "Loaded bad channels from: " << fullname << std::endl;
-    }
+    mf::LogInfo("ConvolutionNetworkAlgo") << "Region Hit size: " << ctx.region_hits.size();
 }
 
-void ConvolutionNetworkAlgo::findRegionBounds(art::Event const& evt, const std::vector<art::Ptr<recob::Hit>>& hits)
+void ConvolutionNetworkAlgo::findRegionBounds(EventContext& ctx, const std::vector<size_t>& hits) const
 {
     std::map<common::PandoraView, std::array<float, 2>> q_cent_map;
     std::map<common::PandoraView, float> tot_q_map;
     common::initialiseChargeMap(q_cent_map, tot_q_map);
-    this->calculateChargeCentroid(evt, hits, q_cent_map, tot_q_map);
+    this->calculateChargeCentroid(ctx, hits, q_cent_map, tot_q_map);
 
     for (const auto& view : {common::TPC_VIEW_U, common::TPC_VIEW_V, common::TPC_VIEW_W}) 
     {
@@ -272,10 +314,10 @@ void ConvolutionNetworkAlgo::findRegionBounds(art::Event const& evt, const std::
 
         float x_min = x_centroid - (_height / 2) * _drift_step;
         float x_max = x_centroid + (_height / 2) * _drift_step;
-        float z_min = z_centroid - (_width / 2) * _wire_pitch[view];
-        float z_max = z_centroid + (_width / 2) * _wire_pitch[view];
+        float z_min = z_centroid - (_width / 2) * _wire_pitch.at(view);
+        float z_max = z_centroid + (_width / 2) * _wire_pitch.at(view);
 
-        _region_bounds[view] = {x_min, x_max, z_min, z_max};
+        ctx.region_bounds[view] = {x_min, x_max, z_min, z_max};
 
         std::cout << "View: " 
             << (view == common::TPC_VIEW_U ? "U" : (view == common::TPC_VIEW_V ? "V" : "W")) 
@@ -284,9 +326,9 @@ void ConvolutionNetworkAlgo::findRegionBounds(art::Event const& evt, const std::
     }
 }
 
-std::tuple<float, float, float, float> ConvolutionNetworkAlgo::getBoundsForView(common::PandoraView view) const
+std::tuple<float, float, float, float> ConvolutionNetworkAlgo::getBoundsForView(const EventContext& ctx, common::PandoraView view) const
 {
-    const auto& bounds = _region_bounds.at(view);  
+    const auto& bounds = ctx.region_bounds.at(view);  
     float drift_min = bounds[0]; 
     float drift_max = bounds[1]; 
     float wire_min = bounds[2];   
@@ -294,16 +336,16 @@ std::tuple<float, float, float, float> ConvolutionNetworkAlgo::getBoundsForView(
     return std::make_tuple(drift_min, drift_max, wire_min, wire_max);
 }
 
-void ConvolutionNetworkAlgo::calculateChargeCentroid(const art::Event& evt, const std::vector<art::Ptr<recob::Hit>>& hits, std::map<common::PandoraView, std::array<float, 2>>& q_cent_map, std::map<common::PandoraView, float>& tot_q_map)
+void ConvolutionNetworkAlgo::calculateChargeCentroid(const EventContext& ctx, const std::vector<size_t>& hits, std::map<common::PandoraView, std::array<float, 2>>& q_cent_map, std::map<common::PandoraView, float>& tot_q_map) const
 {
-    for (const auto& hit : hits)
+    const common::HitTable& table = ctx.hit_table;
+    for (size_t i : hits)
     {
-        common::PandoraView view = common::GetPandoraView(hit);
-        const TVector3 pos = common::GetPandoraHitPosition(evt, hit, view);
-        float charge = _calo_alg->ElectronsFromADCArea(hit->Integral(), hit->WireID().Plane);
+        common::PandoraView view = table.view[i];
+        float charge = table.charge[i];
 
-        q_cent_map[view][0] += pos.X() * charge;  
-        q_cent_map[view][1] += pos.Z() * charge;  
+        q_cent_map[view][0] += table.drift[i] * charge;  
+        q_cent_map[view][1] += table.wire[i] * charge;  
         tot_q_map[view] += charge;
     }
 
@@ -317,8 +359,10 @@ void ConvolutionNetworkAlgo::calculateChargeCentroid(const art::Event& evt, cons
     }
 }
 
-void ConvolutionNetworkAlgo::prepareTrainingSample(art::Event const& evt) 
+void ConvolutionNetworkAlgo::prepareTrainingSample(art::Event const& evt, const EventContext& ctx) 
 {
+    const common::HitTable& table = ctx.hit_table;
+
     std::array<float, 3> nu_vtx = {0.0f, 0.0f, 0.0f};
     bool found_vertex = false;
 
@@ -327,38 +371,29 @@ void ConvolutionNetworkAlgo::prepareTrainingSample(art::Event const& evt)
         return; 
 
     signature::Pattern patt;
-    bool patt_found = true;
-    for (auto& signatureTool : _signatureToolsVec) {
-        signature::Signature signature; 
-        if (!signatureTool->constructSignature(evt, signature)) {
-            patt_found = false;
-            break;
-        }
-
-        patt.push_back(signature);
-    }
+    bool patt_found = _pattern_source->load(evt, patt);
 
     if (!patt_found && !patt.empty())
         patt.clear();
 
-    unsigned int n_flags = _signatureToolsVec.size(); 
+    const signature::SignatureIndex sig_index(patt);
+
+    unsigned int n_flags = _pattern_source->size(); 
+    unsigned int n_flag_words = network::flagWords(n_flags);
     int run = evt.run();
     int subrun = evt.subRun();
     int event = evt.event();
 
-    std::map<common::PandoraView, std::vector<art::Ptr<recob::Hit>>> region_hits;
-    for (const art::Ptr<recob::Hit>& hit : _region_hits) 
-    {
-        common::PandoraView view = common::GetPandoraView(hit);
-        region_hits[view].push_back(hit);
-    }
+    std::map<common::PandoraView, std::vector<size_t>> region_hits;
+    for (size_t i : ctx.region_hits) 
+        region_hits[table.view[i]].push_back(i);
 
     for (const auto& [view, evt_view_hits] : region_hits)
     {
         float x_vtx = nu_vtx[0];
         float z_vtx = (common::ProjectToWireView(nu_vtx[0], nu_vtx[1], nu_vtx[2], view)).Z();
 
-        auto [drift_min, drift_max, wire_min, wire_max] = this->getBoundsForView(view);
+        auto [drift_min, drift_max, wire_min, wire_max] = this->getBoundsForView(ctx, view);
         if (x_vtx > (drift_min - 1.f) && x_vtx < (drift_max + 1.f) && z_vtx > (wire_min - 1.f) && z_vtx < (wire_max + 1.f))
         {           
             unsigned int n_hits = 0;
@@ -373,70 +408,55 @@ void ConvolutionNetworkAlgo::prepareTrainingSample(art::Event const& evt)
                                             static_cast<float>(_width),
                                             x_vtx, z_vtx, 
                                             drift_min, drift_max, 
-                                            wire_min, wire_max };
+                                            wire_min, wire_max,
+                                            static_cast<float>(n_flag_words) };
 
             n_meta = feat_vec.size();
             feat_vec[2] = static_cast<float>(n_meta);
 
-            for (const auto& hit : evt_view_hits)
+            for (size_t i : evt_view_hits)
             {
-                const geo::WireID hit_wire(hit->WireID());
-                if (hit_wire.Wire >= art::ServiceHandle<geo::Geometry>()->Nwires(hit_wire)) 
-                    continue;
-
-                const auto pos = common::GetPandoraHitPosition(evt, hit, static_cast<common::PandoraView>(view));
-                float x = pos.X();
-                float z = pos.Z();
-                float q = _calo_alg->ElectronsFromADCArea(hit->Integral(), hit->WireID().Plane);
+                float x = table.drift[i];
+                float z = table.wire[i];
+                float q = table.charge[i];
 
-                std::vector<float> signature_flags(n_flags, 0.f);
-                if (_mcp_bkth_assoc != nullptr) 
+                signature::SignatureMask flags = 0;
+                if (ctx.mcp_bkth_assoc != nullptr && !sig_index.empty()) 
                 {
-                    const auto& assmcp = _mcp_bkth_assoc->at(hit.key());
-                    const auto& assmdt = _mcp_bkth_assoc->data(hit.key());
+                    const auto& assmcp = ctx.mcp_bkth_assoc->at(table.key[i]);
+                    const auto& assmdt = ctx.mcp_bkth_assoc->data(table.key[i]);
 
-                    for (unsigned int ia = 0; ia < assmcp.size(); ++ia) 
+                    for (unsigned int ia = 0; ia < assmcp.size() && flags == 0; ++ia) 
                     {
-                        bool found_flag = false;
                         if (assmdt[ia]->isMaxIDE == 1) 
-                        {
-                            size_t sig_ctr = 0;
-                            for (const auto& sig : patt) 
-                            {
-                                for (size_t it = 0; it < sig.size(); ++it)
-                                {
-                                    if (sig[it]->TrackId() == assmcp[ia]->TrackId()) 
-                                    {
-                                        signature_flags.at(sig_ctr) = 1.f;
-                                        found_flag = true;
-
-                                        break;
-                                    }
-                                }
-                                sig_ctr++;
-                            }
-                        }
-
-                        if (found_flag)
-                            break;
+                            flags = sig_index.mask(assmcp[ia]->TrackId());
                     }
                 }
 
                 feat_vec.insert(feat_vec.end(), {x, z, q});
-                feat_vec.insert(feat_vec.end(), signature_flags.begin(), signature_flags.end());
+                for (unsigned int w = 0; w < n_flag_words; ++w)
+                    feat_vec.push_back(static_cast<float>((flags >> (w * network::kFlagBitsPerWord)) & 0xFFFF));
                 ++n_hits;
             }
 
             feat_vec[0] = static_cast<float>(n_hits);
 
-            std::string view_string = (view == common::TPC_VIEW_U) ? "U" : (view == common::TPC_VIEW_V) ? "V" : "W";
-            std::string training_filename = _training_output_file + "_" + view_string + ".csv";
-            this->produceTrainingSample(training_filename, feat_vec, true);
+            std::lock_guard<std::mutex> lock(_output_mutex);
+            if (_training_output_format == "shards")
+            {
+                _shard_writers.at(view)->write(feat_vec);
+            }
+            else
+            {
+                std::string view_string = (view == common::TPC_VIEW_U) ? "U" : (view == common::TPC_VIEW_V) ? "V" : "W";
+                std::string training_filename = _training_output_file + "_" + view_string + ".csv";
+                this->produceTrainingSample(training_filename, feat_vec, true);
+            }
         }
     }
 }
 
-void ConvolutionNetworkAlgo::getNuVertex(art::Event const& evt, std::array<float, 3>& nu_vtx, bool& found_vertex)
+void ConvolutionNetworkAlgo::getNuVertex(art::Event const& evt, std::array<float, 3>& nu_vtx, bool& found_vertex) const
 {
     found_vertex = false;
 
@@ -469,87 +489,194 @@ void ConvolutionNetworkAlgo::produceTrainingSample(const std::string& filename,
     out_file.close();
 }
 
-void ConvolutionNetworkAlgo::infer(art::Event const& evt, std::map<int, std::vector<art::Ptr<recob::Hit>>>& classified_hits) 
+void ConvolutionNetworkAlgo::infer(art::Event const& evt, const EventContext& ctx, network::SparseImageBuilder& builder) 
 {
-    std::map<common::PandoraView, std::vector<art::Ptr<recob::Hit>>> region_hits;
-    for (const auto& hit : _region_hits)
-        region_hits[common::GetPandoraView(hit)].push_back(hit);
+    std::map<common::PandoraView, std::vector<size_t>> region_hits;
+    for (size_t i : ctx.region_hits)
+        region_hits[ctx.hit_table.view[i]].push_back(i);
 
     for (const auto& [view, evt_view_hits] : region_hits)
     {
-        torch::Tensor network_input;
-        std::map<art::Ptr<recob::Hit>,std::pair<int, int>> calohit_pixel;
-
-        this->makeNetworkInput(evt, evt_view_hits, view, network_input, calohit_pixel);
-
-        torch::Tensor output;
-        if (view == common::TPC_VIEW_U)
-            output = _model_u->forward({network_input}).toTensor();
-        else if (view == common::TPC_VIEW_V)
-            output = _model_v->forward({network_input}).toTensor();
-        else if (view == common::TPC_VIEW_W)
-            output = _model_w->forward({network_input}).toTensor();
-
-        torch::Tensor predicted_classes = torch::argmax(output, 1); 
-        auto classes_accessor{predicted_classes.accessor<int64_t, 4>()};
-        
-        for (size_t i = 0; i < evt_view_hits.size(); ++i)
-        {
-            const auto& hit = evt_view_hits[i];
+        network::InferenceRequest request;
+        request.run = evt.run();
+        request.subrun = evt.subRun();
+        request.event = evt.event();
+        request.view = view;
 
-            const auto pixel = calohit_pixel.at(hit);
-            int predicted_class = predicted_classes[0][pixel.first][pixel.second].item<int>();
+        this->makeNetworkInput(ctx, builder, evt_view_hits, view, request.image);
+        if (!_calibration_writers.empty())
+            this->produceCalibrationSample(evt, ctx, view, evt_view_hits);
 
-            classified_hits[predicted_class].push_back(hit);
-        }
-    }
+        request.hit_keys.reserve(evt_view_hits.size());
+        for (size_t i : evt_view_hits)
+            request.hit_keys.push_back(ctx.hit_table.key[i]);
 
-    for (const auto& [class_id, hits] : classified_hits)
-        std::cout << "Class " << class_id << " has " << hits.size() << " hits.";
+        _inference_queue->push(std::move(request));
+    }
 }
 
-void ConvolutionNetworkAlgo::makeNetworkInput(const art::Event& evt, const std::vector<art::Ptr<recob::Hit>>& hit_list, const common::PandoraView view, torch::Tensor& network_input, std::map<art::Ptr<recob::Hit>,std::pair<int, int>>& calohit_pixel_map)
+void ConvolutionNetworkAlgo::checkTiling(fhicl::ParameterSet const& pset, const std::map<common::PandoraView, network::Model>& models) const
 {
-    const auto [x_min, x_max, z_min, z_max] = this->getBoundsForView(view);
-    std::vector<double> x_bin_edges(_width + 1);
-    std::vector<double> z_bin_edges(_height + 1);
+    const double threshold = pset.get<double>("TileAgreementThreshold", 1.);
+    network::SparseImageBuilder builder{_height, _width};
 
-    x_bin_edges[0] = x_min;
-    const double dx = (x_max - x_min) / _width;
+    for (const auto& view : {common::TPC_VIEW_U, common::TPC_VIEW_V, common::TPC_VIEW_W})
+    {
+        std::string view_string = (view == common::TPC_VIEW_U) ? "U" : (view == common::TPC_VIEW_V) ? "V" : "W";
+        const auto files = pset.get<std::vector<std::string>>("TileCheckFiles" + view_string, {});
+        if (files.empty())
+            throw cet::exception("ConvolutionNetworkAlgo") << "TileSize " << _tile_config.size << " needs TileCheckFiles" << view_string;
+
+        network::AgreementStats stats;
+        try {
+            network::TrainingShardReader reader(files);
+            std::vector<network::SparseImage> images(reader.size());
+            for (size_t e = 0; e < reader.size(); ++e)
+                network::BuildSampleImage(reader.event(e), builder, _height, _width, images[e]);
+
+            stats = network::CompareTiled(models.at(view), view, images, _tile_config);
+        } catch (const std::runtime_error& e) {
+            throw cet::exception("ConvolutionNetworkAlgo") << "Tiling check for view " << view_string << " failed: " << e.what();
+        }
 
-    for (int i = 1; i <= _width; ++i)
-        x_bin_edges[i] = x_bin_edges[i - 1] + dx;
+        mf::LogInfo("ConvolutionNetworkAlgo") << "Tiling check view " << view_string << ": " << stats.agreement() 
+            << " per-hit class agreement with full-image inference over " << stats.n_hits << " hits in " << stats.n_events << " events";
 
-    z_bin_edges[0] = z_min;
-    const double dz = (z_max - z_min) / _height;
+        if (stats.n_hits == 0 || stats.agreement() < threshold)
+            throw cet::exception("ConvolutionNetworkAlgo") << "Tiled inference for view " << view_string << " agrees with full-image inference on " 
+                << stats.agreement() << " of hits, below TileAgreementThreshold " << threshold << "; TileHalo " << _tile_config.halo 
+                << " is likely smaller than the network's receptive field";
+    }
+}
 
-    for (int i = 1; i <= _height; ++i)
-        z_bin_edges[i] = z_bin_edges[i - 1] + dz;
+void ConvolutionNetworkAlgo::produceCalibrationSample(art::Event const& evt, const EventContext& ctx, const common::PandoraView view, const std::vector<size_t>& hit_list)
+{
+    const auto [drift_min, drift_max, wire_min, wire_max] = this->getBoundsForView(ctx, view);
+
+    // Same meta block as prepareTrainingSample, with no signature flags.
+    unsigned int n_meta = 0;
+    std::vector<float> feat_vec = { static_cast<float>(hit_list.size()),
+                                    0.f,
+                                    static_cast<float>(n_meta),
+                                    static_cast<float>(evt.run()),
+                                    static_cast<float>(evt.subRun()),
+                                    static_cast<float>(evt.event()),
+                                    static_cast<float>(_height),
+                                    static_cast<float>(_width),
+                                    0.f, 0.f,
+                                    drift_min, drift_max,
+                                    wire_min, wire_max,
+                                    static_cast<float>(network::flagWords(0)) };
+
+    n_meta = feat_vec.size();
+    feat_vec[2] = static_cast<float>(n_meta);
+
+    for (size_t i : hit_list)
+        feat_vec.insert(feat_vec.end(), {ctx.hit_table.drift[i], ctx.hit_table.wire[i], ctx.hit_table.charge[i]});
+
+    std::lock_guard<std::mutex> lock(_output_mutex);
+    auto& writer = _calibration_writers.at(view);
+    if (writer->eventsWritten() < _calibration_events)
+        writer->write(feat_vec);
+}
 
-    network_input = torch::zeros({1, 1, _height, _width});
-    auto accessor = network_input.accessor<float, 4>();
-    for (const auto& hit : hit_list)
+// Called from whichever schedule completes the batch, so it logs one
+// message per event and view rather than writing to stdout.
+void ConvolutionNetworkAlgo::handleInferenceResult(network::InferenceResult&& result)
+{
+    std::map<int, size_t> class_counts;
+    for (int predicted_class : result.hit_classes)
     {
-        const auto pos = common::GetPandoraHitPosition(evt, hit, static_cast<common::PandoraView>(view));
-        float x = pos.X();
-        float z = pos.Z();
+        if (predicted_class >= 0)
+            ++class_counts[predicted_class];
+    }
 
-        const int pixel_x{static_cast<int>(std::floor((x - x_bin_edges[0]) / dx))};
-        const int pixel_z{static_cast<int>(std::floor((z - z_bin_edges[0]) / dz))};
+    mf::LogDebug log("ConvolutionNetworkAlgo");
+    log << "Event " << result.run << ":" << result.subrun << ":" << result.event << " view " << result.view << " hits per class:";
+    for (const auto& [class_id, n_hits] : class_counts)
+        log << " " << class_id << "=" << n_hits;
+}
+
+void ConvolutionNetworkAlgo::makeNetworkInput(const EventContext& ctx, network::SparseImageBuilder& builder, const std::vector<size_t>& hit_list, const common::PandoraView view, network::SparseImage& image) const
+{
+    const common::HitTable& table = ctx.hit_table;
+    const auto [x_min, x_max, z_min, z_max] = this->getBoundsForView(ctx, view);
+
+    std::vector<float> x(hit_list.size()), z(hit_list.size()), q(hit_list.size());
+    for (size_t j = 0; j < hit_list.size(); ++j)
+    {
+        const size_t i = hit_list[j];
+        x[j] = table.drift[i];
+        z[j] = table.wire[i];
+        q[j] = table.charge[i];
+    }
 
-        if (pixel_x >= 0 && pixel_x < _width && pixel_z >= 0 && pixel_z < _height)
+    builder.build(x, z, q, x_min, x_max, z_min, z_max, image);
+}
+
+void ConvolutionNetworkAlgo::beginJob(art::ProcessingFrame const&) 
+{
+    common::PandoraGeometryLUT::Instance();
+
+    if (!_training_mode && _calibration_events > 0 && !_calibration_output_file.empty())
+    {
+        for (const auto& view : {common::TPC_VIEW_U, common::TPC_VIEW_V, common::TPC_VIEW_W})
         {
-            float q = _calo_alg->ElectronsFromADCArea(hit->Integral(), hit->WireID().Plane);
-            accessor[0][0][pixel_z][pixel_x] += q;
-            calohit_pixel_map.insert({hit, {pixel_z, pixel_x}});
+            std::string view_string = (view == common::TPC_VIEW_U) ? "U" : (view == common::TPC_VIEW_V) ? "V" : "W";
+            _calibration_writers[view] = std::make_unique<network::TrainingShardWriter>(_calibration_output_file + "_" + view_string, 
+                0, _shard_chunk_size, 0);
         }
     }
+
+    if (!_training_mode || _training_output_format != "shards")
+        return;
+
+    for (const auto& view : {common::TPC_VIEW_U, common::TPC_VIEW_V, common::TPC_VIEW_W})
+    {
+        std::string view_string = (view == common::TPC_VIEW_U) ? "U" : (view == common::TPC_VIEW_V) ? "V" : "W";
+        _shard_writers[view] = std::make_unique<network::TrainingShardWriter>(_training_output_file + "_" + view_string, 
+            _shard_compression_level, _shard_chunk_size, _shard_max_events);
+    }
 }
 
-void ConvolutionNetworkAlgo::beginJob() 
-{}
+void ConvolutionNetworkAlgo::beginRun(art::Run const& run, art::ProcessingFrame const&)
+{
+    common::PandoraGeometryLUT::Instance().updateDrift();
+}
+
+void ConvolutionNetworkAlgo::endJob(art::ProcessingFrame const&) 
+{
+    if (_inference_queue)
+    {
+        _inference_queue->flush();
+
+        const auto stats = _inference_queue->stats();
+        mf::LogInfo("ConvolutionNetworkAlgo") << "Inference: " << stats.n_images << " images in " << stats.n_batches << " forward calls"
+            << ", effective batch size " << stats.effectiveBatchSize()
+            << ", " << stats.imagesPerSecond() << " images/s"
+            << ", mean latency " << stats.meanLatency() << " s, max latency " << stats.max_latency_seconds << " s";
+
+        if (_tile_config.enabled())
+            mf::LogInfo("ConvolutionNetworkAlgo") << "Tiled inference: ran " << stats.n_tiles_run << " of " << stats.n_tiles 
+                << " tiles, skipped fraction " << stats.tileSkipFraction();
+    }
+
+    for (auto& [view, writer] : _shard_writers)
+    {
+        writer->close();
+        mf::LogInfo("ConvolutionNetworkAlgo") << "Training shards for view " << view << ": " << writer->eventsWritten() << " events, " 
+            << writer->shardsWritten() << " shards, " << writer->bytesWritten() << " bytes";
+    }
 
-void ConvolutionNetworkAlgo::endJob() 
-{}
+    _shard_writers.clear();
+
+    for (auto& [view, writer] : _calibration_writers)
+    {
+        writer->close();
+        mf::LogInfo("ConvolutionNetworkAlgo") << "Calibration samples for view " << view << ": " << writer->eventsWritten() << " events";
+    }
+
+    _calibration_writers.clear();
+}
 
 DEFINE_ART_MODULE(ConvolutionNetworkAlgo)
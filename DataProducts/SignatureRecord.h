@@ -0,0 +1,28 @@
+#ifndef SIGNATURERECORD_H
+#define SIGNATURERECORD_H
+
+#include <string>
+#include <vector>
+
+namespace signature
+{
+    // Result of one signature tool for an event, as written by
+    // SignatureProducer: the TrackIds of the signature's particles in the
+    // order the tool found them, and the tool's vertex if it provides one.
+    // label is the tool's key in the producer's SignatureTools table, which
+    // consumers match against their own; tool_pset_id is the ParameterSetID
+    // of the tool's configuration, which must match theirs for the record to
+    // stand in for running the tool.
+    struct SignatureRecord
+    {
+        std::string label;
+        std::string tool_type;
+        std::string tool_pset_id;
+        bool found = false;
+        std::vector<int> track_ids;
+        bool has_vertex = false;
+        float vertex[3] = {0.f, 0.f, 0.f};
+    };
+}
+
+#endif
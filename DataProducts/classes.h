@@ -0,0 +1,5 @@
+#include "canvas/Persistency/Common/Wrapper.h"
+
+#include "DataProducts/SignatureRecord.h"
+
+#include <vector>
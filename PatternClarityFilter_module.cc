@@ -1,6 +1,7 @@
-#include "art/Framework/Core/EDFilter.h"
+#include "art/Framework/Core/SharedFilter.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Run.h"
 #include "art/Framework/Principal/Handle.h"
 
 #include "canvas/Persistency/Common/FindManyP.h"
@@ -8,6 +9,7 @@
 #include "lardataobj/AnalysisBase/BackTrackerMatchingData.h"
 #include "canvas/Utilities/InputTag.h"
 #include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
 #include "larcore/Geometry/Geometry.h"
 #include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
 #include "lardataobj/RecoBase/Hit.h"
@@ -21,12 +23,17 @@
 #include "CommonFunctions/Corrections.h"
 #include "CommonFunctions/Region.h"
 #include "CommonFunctions/Types.h"
-#include "CommonFunctions/Visualisation.h"
+#include "Services/VisualisationService.h"
+#include "CommonFunctions/DeadWireField.h"
+#include "CommonFunctions/FilterPipeline.h"
+
+#include "Services/BadChannelService.h"
 
 #include "art/Utilities/ToolMacros.h"
 #include "art/Utilities/make_tool.h"
 
 #include "SignatureTools/SignatureToolBase.h"
+#include "SignatureTools/PatternSource.h"
 #include "SignatureTools/VertexToolBase.h"
 
 #include "larcorealg/Geometry/PlaneGeo.h"
@@ -42,8 +49,9 @@
 #include <unordered_map>
 #include <cmath>
 #include <chrono>
+#include <atomic>
 
-class PatternClarityFilter : public art::EDFilter 
+class PatternClarityFilter : public art::SharedFilter 
 {
 public:
     explicit PatternClarityFilter(fhicl::ParameterSet const &pset);
@@ -53,15 +61,15 @@ public:
     PatternClarityFilter &operator=(PatternClarityFilter const &) = delete;
     PatternClarityFilter &operator=(PatternClarityFilter &&) = delete;
 
-    bool filter(art::Event &e) override;
+    bool filter(art::Event &e, art::ProcessingFrame const &frame) override;
+    void beginJob(art::ProcessingFrame const &frame) override;
+    void beginRun(art::Run const &r, art::ProcessingFrame const &frame) override;
+    void endJob(art::ProcessingFrame const &frame) override;
 
 private:
     art::InputTag _HitProducer, _MCPproducer, _MCTproducer, _BacktrackTag;
 
-    const geo::GeometryCore* _geo;
-
-    std::string _bad_channel_file;
-    std::vector<bool> _bad_channel_mask;
+    common::DeadWireField _dead_wire_field;
 
     double _patt_hit_comp_thresh;
     int _patt_hit_thresh;
@@ -71,235 +79,250 @@ private:
     double _sig_exclus_thresh;
 
     calo::CalorimetryAlg* _calo_alg;
-    std::vector<std::unique_ptr<::signature::SignatureToolBase>> _signatureToolsVec;
+    ::signature::PatternSource _pattern_source;
     int _targetDetectorPlane;
     bool _quickVisualise;
+    std::atomic<size_t> _n_visualised{0};
+
+    // Truth totals for one pattern particle: the hits whose largest energy
+    // deposit it made, and its back-tracked charge over all hits, inclusive
+    // and restricted to hits it dominates above HitExclusivityThreshold.
+    struct TruthAccumulator
+    {
+        int n_hits = 0;
+        double q_inclusive = 0.;
+        double q_exclusive = 0.;
+    };
+
+    struct PatternTruth
+    {
+        size_t n_mc_hits = 0;
+        size_t n_patt_hits = 0;
+        std::unordered_map<int, TruthAccumulator> particles;
+    };
+
+    // Per-event state shared by the selection stages; the hits and their
+    // truth associations are only read if a stage that needs them runs.
+    struct FilterContext
+    {
+        FilterContext(art::Event &event, const PatternClarityFilter &filter)
+            : e{event}
+            , truth{[this, &filter] { return filter.loadPatternTruth(e, patt); }}
+        {}
+
+        art::Event &e;
+        signature::Pattern patt;
+        common::LazyProduct<PatternTruth> truth;
+    };
 
-    bool filterPatternCompleteness(art::Event &e, signature::Pattern& patt, const std::vector<art::Ptr<recob::Hit>> mc_hits, const std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>>& mcp_bkth_assoc);
-    bool filterSignatureIntegrity(art::Event &e, signature::Pattern& patt, const std::vector<art::Ptr<recob::Hit>> mc_hits, const std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>>& mcp_bkth_assoc);
-    bool filterHitExclusivity(art::Event &e, signature::Pattern& patt, const std::vector<art::Ptr<recob::Hit>> mc_hits, const std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>>& mcp_bkth_assoc); 
+    common::FilterPipeline<FilterContext> _pipeline;
+
+    bool constructPattern(art::Event &e, signature::Pattern& patt) const;
+    std::unique_ptr<PatternTruth> loadPatternTruth(const art::Event &e, const signature::Pattern& patt) const;
+    void accumulatePatternTruth(const signature::Pattern& patt, const std::vector<art::Ptr<recob::Hit>>& evt_hits, const art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>& mcp_bkth_assoc, PatternTruth& truth) const;
+
+    bool filterPatternCompleteness(const PatternTruth& truth) const;
+    bool filterSignatureIntegrity(const signature::Pattern& patt) const;
+    bool filterHitExclusivity(const signature::Pattern& patt, const PatternTruth& truth) const;
 };
 
 PatternClarityFilter::PatternClarityFilter(fhicl::ParameterSet const &pset)
-    : EDFilter{pset}
+    : SharedFilter{pset}
     , _HitProducer{pset.get<art::InputTag>("HitProducer", "gaushit")}
     , _MCPproducer{pset.get<art::InputTag>("MCPproducer", "largeant")}
     , _MCTproducer{pset.get<art::InputTag>("MCTproducer", "generator")}
     , _BacktrackTag{pset.get<art::InputTag>("BacktrackTag", "gaushitTruthMatch")}
-    , _bad_channel_file{pset.get<std::string>("BadChannelFile", "badchannels.txt")}
     , _patt_hit_comp_thresh{pset.get<double>("PatternHitCompletenessThreshold", 0.5)}
     , _patt_hit_thresh{pset.get<int>("PatternHitThreshold", 100)}
     , _sig_hit_comp_thresh{pset.get<double>("SignatureHitCompletenessThreshold", 0.1)}
     , _chan_act_reg{pset.get<int>("ChannelActiveRegion", 3)}
     , _hit_exclus_thresh{pset.get<double>("HitExclusivityThreshold", 0.5)}
     , _sig_exclus_thresh{pset.get<double>("SignatureExclusivityThreshold", 0.8)}
+    , _pattern_source{pset}
     , _targetDetectorPlane{pset.get<int>("TargetDetectorPlane", 2)}
     , _quickVisualise{pset.get<bool>("QuickVisualise", true)}
 {
     _calo_alg = new calo::CalorimetryAlg(pset.get<fhicl::ParameterSet>("CaloAlg"));
 
-    const fhicl::ParameterSet &tool_psets = pset.get<fhicl::ParameterSet>("SignatureTools");
-    for (auto const &tool_pset_label : tool_psets.get_pset_names())
-    {
-        auto const tool_pset = tool_psets.get<fhicl::ParameterSet>(tool_pset_label);
-        _signatureToolsVec.push_back(art::make_tool<::signature::SignatureToolBase>(tool_pset));
-    };
+    // A clear pattern is defined as requiring that:
+    // 1) the interaction topology is dominated by its specific pattern, 
+    // 2) that each signature of the pattern retains its integrity within the detector, 
+    // 3) and that most of the hits of the signature are exclusive. 
+    // The criteria run cheapest first; every one needs the pattern, which is
+    // free and added first so that it always leads.
+    _pipeline.addProduct("hits", 10.);
+    _pipeline.addProduct("backtracker", 100.);
+    _pipeline.addStage("pattern", 0., {}, [this](FilterContext &ctx) { return this->constructPattern(ctx.e, ctx.patt); });
+    _pipeline.addStage("completeness", 1., {"hits", "backtracker"}, [this](FilterContext &ctx) {
+        const PatternTruth* truth = ctx.truth.get();
+        return truth != nullptr && this->filterPatternCompleteness(*truth);
+    });
+    _pipeline.addStage("integrity", 1., {}, [this](FilterContext &ctx) { return this->filterSignatureIntegrity(ctx.patt); });
+    _pipeline.addStage("exclusivity", 1., {"hits", "backtracker"}, [this](FilterContext &ctx) {
+        const PatternTruth* truth = ctx.truth.get();
+        return truth != nullptr && this->filterHitExclusivity(ctx.patt, *truth);
+    });
+    _pipeline.order();
+
+    serialize<art::InEvent>();
+}
 
-    _geo = art::ServiceHandle<geo::Geometry>()->provider();
-    size_t num_channels = _geo->Nchannels();
-    _bad_channel_mask.resize(num_channels, false);
-
-    if (!_bad_channel_file.empty()) {
-        cet::search_path sp("FW_SEARCH_PATH");
-        std::string fullname;
-        sp.find_file(_bad_channel_file, fullname);
-        if (fullname.empty()) 
-            throw cet::exception("PatternClarityFilter") << "-- Bad channel file not found: " << _bad_channel_file;
-
-        std::ifstream inFile(fullname, std::ios::in);
-        std::string line;
-        while (std::getline(inFile, line)) {
-            if (line.find("#") != std::string::npos) continue;
-            std::istringstream ss(line);
-            int ch1, ch2;
-            ss >> ch1;
-            if (!(ss >> ch2)) ch2 = ch1;
-            for (int i = ch1; i <= ch2; ++i) {
-                _bad_channel_mask[i] = true;
-            }
-        }
+void PatternClarityFilter::beginJob(art::ProcessingFrame const &)
+{
+    common::PandoraGeometryLUT::Instance();
+}
+
+void PatternClarityFilter::beginRun(art::Run const &r, art::ProcessingFrame const &)
+{
+    common::PandoraGeometryLUT::Instance().updateDrift();
+    _dead_wire_field.build(art::ServiceHandle<BadChannelService>()->mask());
+}
+
+void PatternClarityFilter::endJob(art::ProcessingFrame const &)
+{
+    if (_quickVisualise)
+    {
+        art::ServiceHandle<VisualisationService>()->flush();
+        mf::LogInfo("PatternClarityFilter") << "Rendered " << _n_visualised << " event displays";
     }
+
+    for (const auto& stage : _pipeline.stats())
+        mf::LogInfo("PatternClarityFilter") << "Stage " << stage.name << ": ran " << stage.n_run << ", rejected " << stage.n_rejected 
+            << ", " << stage.seconds << " s";
 }
 
-bool PatternClarityFilter::filter(art::Event &e) 
+bool PatternClarityFilter::filter(art::Event &e, art::ProcessingFrame const &) 
 {
-    signature::Pattern patt;
-    for (auto &signatureTool : _signatureToolsVec) {
-        signature::Signature signature;
-        if (!signatureTool->constructSignature(e, signature))
-            return false;
+    FilterContext ctx(e, *this);
+    if (!_pipeline.run(ctx))
+        return false;
 
-        patt.push_back(signature);
+    if (_quickVisualise)
+    {
+        common::EventSnapshot snapshot;
+        std::string filename = "event_" + std::to_string(e.run()) + "_" + std::to_string(e.subRun()) + "_" + std::to_string(e.event());
+        common::SnapshotEvent(e, _MCPproducer, _HitProducer, _BacktrackTag, ctx.patt, filename, snapshot);
+        snapshot.render_truth = true;
+        snapshot.render_signature = true;
+        art::ServiceHandle<VisualisationService>()->push(std::move(snapshot));
+        _n_visualised += 1;
     }
+    
+    return true; 
+}
+
+bool PatternClarityFilter::constructPattern(art::Event &e, signature::Pattern& patt) const
+{
+    return _pattern_source.load(e, patt);
+}
 
+std::unique_ptr<PatternClarityFilter::PatternTruth> PatternClarityFilter::loadPatternTruth(const art::Event &e, const signature::Pattern& patt) const
+{
     art::Handle<std::vector<recob::Hit>> hit_h;
     if (!e.getByLabel(_HitProducer, hit_h)) 
-        return false;
+        return nullptr;
 
     std::vector<art::Ptr<recob::Hit>> evt_hits;
     art::fill_ptr_vector(evt_hits, hit_h);
-    auto mcp_bkth_assoc = std::make_unique<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>>(hit_h, e, _BacktrackTag);
+    art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData> mcp_bkth_assoc(hit_h, e, _BacktrackTag);
 
-    std::vector<art::Ptr<recob::Hit>> mc_hits;
-    for (const auto& hit : evt_hits) {
-        if (_bad_channel_mask[hit->Channel()]) 
-            continue; 
+    art::ServiceHandle<BadChannelService>()->mask().removeBad(evt_hits, [](const art::Ptr<recob::Hit>& hit) { return hit->Channel(); });
 
-        const geo::WireID& wire_id = hit->WireID(); 
-        if (wire_id.Plane != static_cast<unsigned int>(_targetDetectorPlane))
-            continue;
+    auto truth = std::make_unique<PatternTruth>();
+    this->accumulatePatternTruth(patt, evt_hits, mcp_bkth_assoc, *truth);
 
-        auto assmcp = mcp_bkth_assoc->at(hit.key());
-        auto assmdt = mcp_bkth_assoc->data(hit.key());
-        for (unsigned int ia = 0; ia < assmcp.size(); ++ia){
-            auto amd = assmdt[ia];
-            if (amd->isMaxIDEN != 1)
-                continue;
-            
-            mc_hits.push_back(hit);
-        }
+    return truth;
+}
+
+void PatternClarityFilter::accumulatePatternTruth(const signature::Pattern& patt, const std::vector<art::Ptr<recob::Hit>>& evt_hits, const art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>& mcp_bkth_assoc, PatternTruth& truth) const
+{
+    for (const auto& sig : patt) {
+        for (const auto& mcp_s : sig)
+            truth.particles.emplace(mcp_s->TrackId(), TruthAccumulator{});
     }
 
-    // A clear pattern is defined as requiring that:
-    // 1) the interaction topology is dominated by its specific pattern, 
-    // 2) that each signature of the pattern retains its integrity within the detector, 
-    // 3) and that most of the hits of the signature are exclusive. 
-    if (!this->filterPatternCompleteness(e, patt, mc_hits, mcp_bkth_assoc))
-        return false;
+    // One pass over the back-tracker associations of the target plane fills
+    // every criterion's totals, independent of the number of pattern particles.
+    for (const auto& hit : evt_hits) {
+        if (hit->WireID().Plane != static_cast<unsigned int>(_targetDetectorPlane))
+            continue;
 
-    if (!this->filterSignatureIntegrity(e, patt, mc_hits, mcp_bkth_assoc))
-        return false;
+        const auto& assmcp = mcp_bkth_assoc.at(hit.key());
+        const auto& assmdt = mcp_bkth_assoc.data(hit.key());
 
-    if (!this->filterHitExclusivity(e, patt, mc_hits, mcp_bkth_assoc))
-        return false;
+        bool is_mc_hit = false;
+        bool is_patt_hit = false;
+        for (unsigned int ia = 0; ia < assmcp.size(); ++ia) {
+            auto amd = assmdt[ia];
+            if (amd->isMaxIDEN == 1)
+                is_mc_hit = true;
 
-    if (_quickVisualise)
-    {
-        std::string filename = "event_" + std::to_string(e.run()) + "_" + std::to_string(e.subRun()) + "_" + std::to_string(e.event());
-        common::visualiseTrueEvent(e, _MCPproducer, _HitProducer, _BacktrackTag, filename);
-        common::visualiseSignature(e, _MCPproducer, _HitProducer, _BacktrackTag, patt, filename);
-    }
-    
-    return true; 
-}
+            auto it = truth.particles.find(assmcp[ia]->TrackId());
+            if (it == truth.particles.end())
+                continue;
 
-bool PatternClarityFilter::filterPatternCompleteness(art::Event &e, signature::Pattern& patt, const std::vector<art::Ptr<recob::Hit>> mc_hits, const std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>>& mcp_bkth_assoc)
-{
-    std::unordered_map<int, int> sig_hit_map;
-    double tot_patt_hit = 0; 
+            TruthAccumulator& acc = it->second;
+            double q = amd->numElectrons * amd->ideNFraction;
+            acc.q_inclusive += q;
+            if (amd->ideNFraction > _hit_exclus_thresh)
+                acc.q_exclusive += q;
 
-    std::vector<art::Ptr<recob::Hit>> patt_hits;
-    for (const auto& sig : patt) {
-        for (const auto& mcp_s : sig) {
-            double sig_hit = 0;
-
-            for (const auto& hit : mc_hits) {
-                auto assmcp = mcp_bkth_assoc->at(hit.key());
-                auto assmdt = mcp_bkth_assoc->data(hit.key());
-
-                for (unsigned int ia = 0; ia < assmcp.size(); ++ia){
-                    auto amd = assmdt[ia];
-                    if (assmcp[ia]->TrackId() == mcp_s->TrackId() && amd->isMaxIDEN == 1) {
-                        patt_hits.push_back(hit);
-                        sig_hit += 1; 
-                    }
-                }
+            if (amd->isMaxIDEN == 1) {
+                acc.n_hits += 1;
+                is_patt_hit = true;
             }
-
-            sig_hit_map[mcp_s->TrackId()] += sig_hit;
-            tot_patt_hit += sig_hit;
         }
+
+        truth.n_mc_hits += is_mc_hit;
+        truth.n_patt_hits += is_patt_hit;
     }
+}
 
-    if (mc_hits.empty() || patt_hits.empty()) 
+bool PatternClarityFilter::filterPatternCompleteness(const PatternTruth& truth) const
+{
+    if (truth.n_mc_hits == 0 || truth.n_patt_hits == 0) 
         return false;
 
-    double patt_comp = static_cast<double>(patt_hits.size()) / mc_hits.size();
+    double tot_patt_hit = static_cast<double>(truth.n_patt_hits);
+    double patt_comp = tot_patt_hit / truth.n_mc_hits;
     std::cout << "Pattern completeness " << patt_comp << std::endl;
     std::cout << "Total pattern hits " << tot_patt_hit << std::endl;
     if (patt_comp < _patt_hit_comp_thresh || tot_patt_hit < _patt_hit_thresh)
         return false;
 
-    for (const auto& [_, num_hits] : sig_hit_map) 
+    for (const auto& [_, acc] : truth.particles) 
     {
-        std::cout << "Signature hit " << num_hits << std::endl;
-        if (num_hits / tot_patt_hit < _sig_hit_comp_thresh) 
+        std::cout << "Signature hit " << acc.n_hits << std::endl;
+        if (acc.n_hits / tot_patt_hit < _sig_hit_comp_thresh) 
             return false;       
     }
 
     return true;
 }
 
-bool PatternClarityFilter::filterSignatureIntegrity(art::Event &e, signature::Pattern& patt, const std::vector<art::Ptr<recob::Hit>> mc_hits, const std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>>& mcp_bkth_assoc)
+bool PatternClarityFilter::filterSignatureIntegrity(const signature::Pattern& patt) const
 {
-    auto isChannelRegionActive = [&](const TVector3& point) -> bool {
-        for (geo::PlaneID const& plane : _geo->IteratePlaneIDs()) {
-            try {
-                geo::WireID wire = _geo->NearestWireID(point, plane);
-                raw::ChannelID_t central_channel = _geo->PlaneWireToChannel(wire);
-
-                for (int offset = -_chan_act_reg; offset <= _chan_act_reg; ++offset) {
-                    raw::ChannelID_t neighboring_channel = central_channel + offset;
-
-                    if (neighboring_channel < 0 || static_cast<size_t>(neighboring_channel) >= _geo->Nchannels())
-                        continue; 
-
-                    if (_bad_channel_mask[neighboring_channel])
-                        return false; 
-                }
-            } catch (const cet::exception&) {
-                return false; 
-            }
-        }
-        return true;
-    };
-
+    std::vector<TVector3> endpoints;
     for (const auto& sig : patt) {
         for (const auto& mcp_s : sig) {
-            TVector3 start(mcp_s->Vx(), mcp_s->Vy(), mcp_s->Vz());
-            if (!isChannelRegionActive(start))
-                return false;
-
-            if (std::abs(mcp_s->PdgCode()) != 13) { 
-                TVector3 end(mcp_s->EndX(), mcp_s->EndY(), mcp_s->EndZ());
-                if (!isChannelRegionActive(end))
-                    return false;
-            }
+            endpoints.emplace_back(mcp_s->Vx(), mcp_s->Vy(), mcp_s->Vz());
+            if (std::abs(mcp_s->PdgCode()) != 13)
+                endpoints.emplace_back(mcp_s->EndX(), mcp_s->EndY(), mcp_s->EndZ());
         }
     }
 
-    return true;
+    return _dead_wire_field.allActive(endpoints, _chan_act_reg);
 }
 
-bool PatternClarityFilter::filterHitExclusivity(art::Event &e, signature::Pattern& patt, const std::vector<art::Ptr<recob::Hit>> mc_hits, const std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>>& mcp_bkth_assoc)
+bool PatternClarityFilter::filterHitExclusivity(const signature::Pattern& patt, const PatternTruth& truth) const
 {
     for (const auto& sig : patt) {
         double sig_q_inclusive = 0.0;
         double sig_q_exclusive = 0.0;
         for (const auto& mcp_s : sig) {
-            for (const auto& hit : mc_hits) {
-                auto assmcp = mcp_bkth_assoc->at(hit.key());
-                auto assmdt = mcp_bkth_assoc->data(hit.key());
-
-                for (unsigned int ia = 0; ia < assmcp.size(); ++ia){
-                    auto amd = assmdt[ia];
-                    if (assmcp[ia]->TrackId() == mcp_s->TrackId()) {
-                        sig_q_inclusive += amd->numElectrons * amd->ideNFraction;
-                        if (amd->ideNFraction > _hit_exclus_thresh) 
-                            sig_q_exclusive += amd->numElectrons * amd->ideNFraction;
-                    }
-                }
-            }
+            const TruthAccumulator& acc = truth.particles.at(mcp_s->TrackId());
+            sig_q_inclusive += acc.q_inclusive;
+            sig_q_exclusive += acc.q_exclusive;
         }
 
         if (sig_q_exclusive / sig_q_inclusive < _sig_exclus_thresh)
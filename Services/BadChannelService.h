@@ -0,0 +1,120 @@
+#ifndef BADCHANNELSERVICE_H
+#define BADCHANNELSERVICE_H
+
+#include "art/Framework/Services/Registry/ActivityRegistry.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art/Framework/Services/Registry/ServiceMacros.h"
+#include "art/Framework/Principal/Run.h"
+#include "cetlib/search_path.h"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+#include "larcore/Geometry/Geometry.h"
+
+#include "CommonFunctions/ChannelMask.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Job-wide bad-channel mask. Each file is read once; when RunMasks is given,
+// the mask covering the next run is selected before that run begins, so
+// modules should fetch mask() per event rather than keep a copy.
+//
+//   BadChannelService:
+//   {
+//       BadChannelFile: "badchannels.txt"
+//       RunMasks: [ { FirstRun: 5000 LastRun: 6000 BadChannelFile: "badchannels_run1.txt" } ]
+//   }
+
+class BadChannelService
+{
+public:
+    BadChannelService(fhicl::ParameterSet const& pset, art::ActivityRegistry& reg)
+    {
+        _n_channels = art::ServiceHandle<geo::Geometry>()->Nchannels();
+        _default = this->loadMask(pset.get<std::string>("BadChannelFile", "badchannels.txt"));
+
+        for (auto const& run_pset : pset.get<std::vector<fhicl::ParameterSet>>("RunMasks", {}))
+        {
+            RunMask run_mask;
+            run_mask.first_run = run_pset.get<int>("FirstRun");
+            run_mask.last_run = run_pset.get<int>("LastRun");
+            run_mask.mask = this->loadMask(run_pset.get<std::string>("BadChannelFile"));
+            _run_masks.push_back(run_mask);
+        }
+
+        _current = _default;
+        reg.sPreBeginRun.watch(this, &BadChannelService::preBeginRun);
+    }
+
+    const common::ChannelMask& mask() const { return *_current; }
+
+    bool bad(raw::ChannelID_t channel) const { return _current->bad(channel); }
+    bool anyBad(long lo, long hi) const { return _current->anyBad(lo, hi); }
+
+private:
+    struct RunMask
+    {
+        int first_run;
+        int last_run;
+        const common::ChannelMask* mask;
+    };
+
+    size_t _n_channels = 0;
+    std::map<std::string, common::ChannelMask> _masks;
+    std::vector<RunMask> _run_masks;
+    const common::ChannelMask* _default = nullptr;
+    const common::ChannelMask* _current = nullptr;
+
+    void preBeginRun(art::Run const& run)
+    {
+        _current = _default;
+        for (const auto& run_mask : _run_masks)
+        {
+            if (static_cast<int>(run.run()) >= run_mask.first_run && static_cast<int>(run.run()) <= run_mask.last_run)
+            {
+                _current = run_mask.mask;
+                break;
+            }
+        }
+    }
+
+    const common::ChannelMask* loadMask(const std::string& filename)
+    {
+        auto it = _masks.find(filename);
+        if (it != _masks.end())
+            return &it->second;
+
+        common::ChannelMask mask(_n_channels);
+        if (!filename.empty()) {
+            cet::search_path sp("FW_SEARCH_PATH");
+            std::string fullname;
+            sp.find_file(filename, fullname);
+            if (fullname.empty())
+                throw cet::exception("BadChannelService") << "Bad channel file not found: " << filename;
+
+            std::ifstream inFile(fullname, std::ios::in);
+            std::string line;
+            while (std::getline(inFile, line)) {
+                if (line.find("#") != std::string::npos) continue;
+                std::istringstream ss(line);
+                int ch1, ch2;
+                if (!(ss >> ch1)) continue;
+                if (!(ss >> ch2)) ch2 = ch1;
+                for (int i = ch1; i <= ch2; ++i)
+                    mask.set(i);
+            }
+        }
+        mask.finalise();
+
+        mf::LogInfo("BadChannelService") << "Loaded " << mask.count() << " bad channels from " << (filename.empty() ? "(none)" : filename);
+        return &_masks.emplace(filename, std::move(mask)).first->second;
+    }
+};
+
+DECLARE_ART_SERVICE(BadChannelService, SHARED)
+
+#endif
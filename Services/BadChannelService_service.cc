@@ -0,0 +1,3 @@
+#include "Services/BadChannelService.h"
+
+DEFINE_ART_SERVICE(BadChannelService)
@@ -0,0 +1,124 @@
+#ifndef TRUTHGRAPHSERVICE_H
+#define TRUTHGRAPHSERVICE_H
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Services/Registry/ActivityRegistry.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art/Framework/Services/Registry/ServiceMacros.h"
+#include "art/Persistency/Provenance/ScheduleContext.h"
+#include "canvas/Persistency/Provenance/EventID.h"
+#include "canvas/Persistency/Provenance/ProductID.h"
+#include "canvas/Utilities/InputTag.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include "CommonFunctions/TruthGraph.h"
+#include "CommonFunctions/DecayTopology.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+// Job-wide cache of the MCParticle truth graph of each event, so that every
+// signature tool, analysis tool and module working on an event shares one
+// graph per MCParticle product instead of rebuilding its own TrackId map.
+// Graphs are keyed by event and product while the event is in flight and
+// dropped when its schedule finishes with it, since input files may repeat
+// event numbers and a graph holds Ptrs into that event's product. Callers
+// keep the returned pointer only while they work on the event.
+//
+// Decay topologies registered by the tools at construction are all matched
+// in one traversal of the graph, the first time any tool asks for matches().
+//
+//   TruthGraphService: {}
+
+class TruthGraphService
+{
+public:
+    TruthGraphService(fhicl::ParameterSet const&, art::ActivityRegistry& reg)
+    {
+        reg.sPostProcessEvent.watch(this, &TruthGraphService::postProcessEvent);
+    }
+
+    // Returns the id under which this topology's match is reported. All
+    // topologies must be registered before the first event. Signature nodes
+    // must pass thresholds, when given.
+    size_t registerTopology(const common::DecayNode& root, std::optional<common::ParticleThresholds> thresholds = std::nullopt)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_matched)
+            throw cet::exception("TruthGraphService") << "Decay topologies must be registered before the first event";
+
+        return _matcher.add(root, std::move(thresholds));
+    }
+
+    std::shared_ptr<const common::DecayMatches> matches(art::Event const& evt, art::InputTag const& mcp_producer)
+    {
+        std::shared_ptr<Entry> entry = this->entry(evt, mcp_producer);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _matched = true;
+        if (!entry->matches)
+            entry->matches = std::make_shared<const common::DecayMatches>(_matcher.match(*entry->graph));
+
+        return entry->matches;
+    }
+
+    std::shared_ptr<const common::TruthGraph> graph(art::Event const& evt, art::InputTag const& mcp_producer)
+    {
+        return this->entry(evt, mcp_producer)->graph;
+    }
+
+private:
+    using Key = std::pair<art::EventID, art::ProductID>;
+
+    struct Entry
+    {
+        std::shared_ptr<const common::TruthGraph> graph;
+        std::shared_ptr<const common::DecayMatches> matches;
+    };
+
+    std::map<Key, std::shared_ptr<Entry>> _entries;
+    common::DecayTopologyMatcher _matcher;
+    bool _matched = false;
+    std::mutex _mutex;
+
+    std::shared_ptr<Entry> entry(art::Event const& evt, art::InputTag const& mcp_producer)
+    {
+        art::Handle<std::vector<simb::MCParticle>> mcp_h;
+        evt.getByLabel(mcp_producer, mcp_h);
+        if (!mcp_h.isValid())
+            throw cet::exception("TruthGraphService") << "No MCParticle product " << mcp_producer << " in event " << evt.id();
+
+        const Key key{evt.id(), mcp_h.id()};
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _entries.find(key);
+            if (it != _entries.end())
+                return it->second;
+        }
+
+        auto graph = std::make_shared<const common::TruthGraph>(mcp_h);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto inserted = _entries.emplace(key, std::make_shared<Entry>(Entry{graph, nullptr}));
+        if (!inserted.second)
+            return inserted.first->second;
+
+        return inserted.first->second;
+    }
+
+    void postProcessEvent(art::Event const& evt, art::ScheduleContext)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _entries.lower_bound(Key{evt.id(), art::ProductID{}});
+        while (it != _entries.end() && it->first.first == evt.id())
+            it = _entries.erase(it);
+    }
+};
+
+DECLARE_ART_SERVICE(TruthGraphService, SHARED)
+
+#endif
@@ -0,0 +1,3 @@
+#include "Services/TruthGraphService.h"
+
+DEFINE_ART_SERVICE(TruthGraphService)
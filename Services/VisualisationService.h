@@ -0,0 +1,45 @@
+#ifndef VISUALISATIONSERVICE_H
+#define VISUALISATIONSERVICE_H
+
+#include "art/Framework/Services/Registry/ActivityRegistry.h"
+#include "art/Framework/Services/Registry/ServiceMacros.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include "CommonFunctions/VisualisationQueue.h"
+
+#include "TROOT.h"
+
+#include <memory>
+
+// Job-wide event display renderer. Every module drawing events pushes its
+// snapshots here, so a job has one render thread however many modules and
+// schedules feed it. ROOT's thread-safety mode is switched on once, when the
+// service is created with the job.
+//
+//   VisualisationService: { QueueSize: 8 }   # snapshots held for the render thread
+
+class VisualisationService
+{
+public:
+    VisualisationService(fhicl::ParameterSet const& pset, art::ActivityRegistry&)
+    {
+        ROOT::EnableThreadSafety();
+        _queue = std::make_unique<common::VisualisationQueue>(pset.get<size_t>("QueueSize", 8));
+    }
+
+    void push(common::EventSnapshot snapshot) { _queue->push(std::move(snapshot)); }
+
+    // Waits for every snapshot pushed so far, and rethrows the first render
+    // failure not yet reported.
+    void flush() { _queue->flush(); }
+
+    size_t rendered() const { return _queue->rendered(); }
+    size_t failed() const { return _queue->failed(); }
+
+private:
+    std::unique_ptr<common::VisualisationQueue> _queue;
+};
+
+DECLARE_ART_SERVICE(VisualisationService, SHARED)
+
+#endif
@@ -0,0 +1,3 @@
+#include "Services/VisualisationService.h"
+
+DEFINE_ART_SERVICE(VisualisationService)
@@ -0,0 +1,119 @@
+#include "art/Framework/Core/SharedProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Utilities/InputTag.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "art/Utilities/ToolMacros.h"
+#include "art/Utilities/make_tool.h"
+
+#include "DataProducts/SignatureRecord.h"
+#include "SignatureTools/SignatureToolBase.h"
+#include "SignatureTools/VertexToolBase.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Runs the SignatureTools once per event and puts one SignatureRecord per
+// tool, in table order, into the event. Modules reading their pattern
+// through signature::PatternSource then take it from here instead of
+// repeating the truth search.
+class SignatureProducer : public art::SharedProducer
+{
+public:
+    explicit SignatureProducer(fhicl::ParameterSet const &pset);
+
+    SignatureProducer(SignatureProducer const &) = delete;
+    SignatureProducer(SignatureProducer &&) = delete;
+    SignatureProducer &operator=(SignatureProducer const &) = delete;
+    SignatureProducer &operator=(SignatureProducer &&) = delete;
+
+    void produce(art::Event &e, art::ProcessingFrame const &frame) override;
+    void endJob(art::ProcessingFrame const &frame) override;
+
+private:
+    struct Tool
+    {
+        std::string label;
+        std::string tool_type;
+        std::string pset_id;
+        std::unique_ptr<::signature::SignatureToolBase> signature;
+        const ::signature::VertexToolBase *vertex = nullptr;
+    };
+
+    std::vector<Tool> _tools;
+
+    std::atomic<size_t> _n_events{0};
+    std::atomic<size_t> _n_patterns{0};
+};
+
+SignatureProducer::SignatureProducer(fhicl::ParameterSet const &pset)
+    : SharedProducer{pset}
+{
+    const fhicl::ParameterSet &tool_psets = pset.get<fhicl::ParameterSet>("SignatureTools");
+    for (auto const &tool_pset_label : tool_psets.get_pset_names())
+    {
+        auto const tool_pset = tool_psets.get<fhicl::ParameterSet>(tool_pset_label);
+
+        Tool tool;
+        tool.label = tool_pset_label;
+        tool.tool_type = tool_pset.get<std::string>("tool_type");
+        tool.pset_id = tool_pset.id().to_string();
+        tool.signature = art::make_tool<::signature::SignatureToolBase>(tool_pset);
+        tool.vertex = dynamic_cast<const ::signature::VertexToolBase *>(tool.signature.get());
+        _tools.push_back(std::move(tool));
+    }
+
+    produces<std::vector<signature::SignatureRecord>>();
+
+    serialize<art::InEvent>();
+}
+
+void SignatureProducer::produce(art::Event &e, art::ProcessingFrame const &)
+{
+    auto records = std::make_unique<std::vector<signature::SignatureRecord>>();
+    records->reserve(_tools.size());
+
+    bool patt_found = true;
+    for (const auto &tool : _tools)
+    {
+        signature::SignatureRecord record;
+        record.label = tool.label;
+        record.tool_type = tool.tool_type;
+        record.tool_pset_id = tool.pset_id;
+
+        signature::Signature signature;
+        record.found = tool.signature->constructSignature(e, signature);
+        for (const auto &mcp : signature)
+            record.track_ids.push_back(mcp->TrackId());
+
+        if (record.found && tool.vertex != nullptr)
+        {
+            const TVector3 vertex = tool.vertex->findVertex(e);
+            record.has_vertex = true;
+            record.vertex[0] = vertex.X();
+            record.vertex[1] = vertex.Y();
+            record.vertex[2] = vertex.Z();
+        }
+
+        patt_found = patt_found && record.found;
+        records->push_back(std::move(record));
+    }
+
+    _n_events += 1;
+    if (patt_found)
+        _n_patterns += 1;
+
+    e.put(std::move(records));
+}
+
+void SignatureProducer::endJob(art::ProcessingFrame const &)
+{
+    mf::LogInfo("SignatureProducer") << "Found the full pattern in " << _n_patterns << " of " << _n_events << " events";
+}
+
+DEFINE_ART_MODULE(SignatureProducer)
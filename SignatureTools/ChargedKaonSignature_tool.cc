@@ -31,16 +31,10 @@ private:
 
 void ChargedKaonSignature::findSignature(art::Event const& evt, Signature& signature, bool& signature_found)
 {
-    auto const &mcp_h = evt.getValidHandle<std::vector<simb::MCParticle>>(_MCPproducer);
+    auto const truth_graph = this->truthGraph(evt);
 
-    std::map<int, art::Ptr<simb::MCParticle>> mcp_map;
-    for (size_t d = 0; d < mcp_h->size(); d++) {
-        const art::Ptr<simb::MCParticle> mcp(mcp_h, d);
-        mcp_map[mcp->TrackId()] = mcp;
-    }
-
-    auto addDaughterInteractions = [this, &signature, &mcp_map](const art::Ptr<simb::MCParticle>& particle, auto& self) -> art::Ptr<simb::MCParticle> {
-        auto daughters = common::GetDaughters(mcp_map.at(particle->TrackId()), mcp_map);
+    auto addDaughterInteractions = [this, &signature, &truth_graph](const art::Ptr<simb::MCParticle>& particle, auto& self) -> art::Ptr<simb::MCParticle> {
+        auto daughters = truth_graph->daughters(particle->TrackId());
         art::Ptr<simb::MCParticle> end_particle = particle;
         for (const auto& daugh : daughters) {
             if (daugh->PdgCode() == particle->PdgCode() && this->assessParticle(*daugh)) {
@@ -52,25 +46,20 @@ void ChargedKaonSignature::findSignature(art::Event const& evt, Signature& signa
         return end_particle;
     };
 
-    for (const auto &mcp : *mcp_h) 
+    for (const auto& kaon : truth_graph->particles())
     {
-        if (std::abs(mcp.PdgCode()) == 321 && mcp.Process() == "primary"  && !signature_found) 
+        if (std::abs(kaon->PdgCode()) == 321 && truth_graph->process(kaon) == common::kProcessPrimary && !signature_found)
         {
-            auto particle_iter = mcp_map.find(mcp.TrackId());
-            if (particle_iter == mcp_map.end()) 
-                continue;
-            
-            auto kaon = particle_iter->second;
             if (!this->assessParticle(*kaon))
                 break;
 
             this->fillSignature(kaon, signature);
             auto end_kaon = addDaughterInteractions(kaon, addDaughterInteractions);
            
-            if (end_kaon->EndProcess() == "Decay" || end_kaon->EndProcess() == "FastScintillation") 
+            if (truth_graph->endProcess(end_kaon) == common::kProcessDecay || truth_graph->endProcess(end_kaon) == common::kProcessFastScintillation) 
             {
                 std::cout << end_kaon->EndProcess() << std::endl;
-                auto decay = common::GetDaughters(mcp_map.at(kaon->TrackId()), mcp_map);
+                auto decay = truth_graph->daughters(kaon->TrackId());
                 std::vector<int> found_dtrs;
                 std::vector<art::Ptr<simb::MCParticle>> clean_decay;
 
@@ -122,11 +111,10 @@ void ChargedKaonSignature::findSignature(art::Event const& evt, Signature& signa
                     {
                         signature_found = true;
 
-                        this->fillSignature(mcp_map[mcp.TrackId()], signature);
+                        this->fillSignature(kaon, signature);
                         for (const auto& elem : clean_decay) 
                         {
-                            const TParticlePDG* info = TDatabasePDG::Instance()->GetParticle(elem->PdgCode());
-                            if (info->Charge() != 0.0) 
+                            if (common::ParticleCharge(elem->PdgCode()) != 0) 
                             {
                                 std::cout << "Filling signature" << std::endl;
                                 this->fillSignature(elem, signature);
@@ -31,15 +31,10 @@ private:
 
 void ChargedSigmaSignature::findSignature(art::Event const& evt, Signature& signature, bool& signature_found)
 {
-    auto const &mcp_h = evt.getValidHandle<std::vector<simb::MCParticle>>(_MCPproducer);
-    std::map<int, art::Ptr<simb::MCParticle>> mcp_map;
-    for (size_t mcp_i = 0; mcp_i < mcp_h->size(); mcp_i++) {
-        const art::Ptr<simb::MCParticle> mcp(mcp_h, mcp_i);
-        mcp_map[mcp->TrackId()] = mcp;
-    }
+    auto const truth_graph = this->truthGraph(evt);
 
-    auto addDaughterInteractions = [this, &signature, &mcp_map](const art::Ptr<simb::MCParticle>& particle, auto& self) -> art::Ptr<simb::MCParticle> {
-        auto daughters = common::GetDaughters(mcp_map.at(particle->TrackId()), mcp_map);
+    auto addDaughterInteractions = [this, &signature, &truth_graph](const art::Ptr<simb::MCParticle>& particle, auto& self) -> art::Ptr<simb::MCParticle> {
+        auto daughters = truth_graph->daughters(particle->TrackId());
         art::Ptr<simb::MCParticle> end_particle = particle;
         for (const auto& daugh : daughters) {
             if (daugh->PdgCode() == particle->PdgCode() && this->assessParticle(*daugh)) {
@@ -51,15 +46,10 @@ void ChargedSigmaSignature::findSignature(art::Event const& evt, Signature& sign
         return end_particle;
     };
 
-    for (const auto &mcp : *mcp_h)
+    for (const auto& sigma : truth_graph->particles())
     {
-        if ((abs(mcp.PdgCode()) == 3112 || abs(mcp.PdgCode()) == 3222) && mcp.Process() == "primary" && !signature_found)
+        if ((std::abs(sigma->PdgCode()) == 3112 || std::abs(sigma->PdgCode()) == 3222) && truth_graph->process(sigma) == common::kProcessPrimary && !signature_found)
         {
-            auto particle_iter = mcp_map.find(mcp.TrackId());
-            if (particle_iter == mcp_map.end()) 
-                continue;
-
-            auto sigma = particle_iter->second; 
             if (!this->assessParticle(*sigma))
                 break;
 
@@ -67,9 +57,9 @@ void ChargedSigmaSignature::findSignature(art::Event const& evt, Signature& sign
             auto end_sigma = addDaughterInteractions(sigma, addDaughterInteractions);
 
             std::cout << end_sigma->EndProcess() << std::endl;
-            if (end_sigma->EndProcess() == "Decay")
+            if (truth_graph->endProcess(end_sigma) == common::kProcessDecay)
             {
-                auto decay = common::GetDaughters(mcp_map.at(sigma->TrackId()), mcp_map);
+                auto decay = truth_graph->daughters(sigma->TrackId());
                 std::vector<int> found_dtrs;
                 std::vector<art::Ptr<simb::MCParticle>> clean_decay;
 
@@ -121,11 +111,10 @@ void ChargedSigmaSignature::findSignature(art::Event const& evt, Signature& sign
                     {
                         signature_found = true;
 
-                        this->fillSignature(mcp_map[mcp.TrackId()], signature);
+                        this->fillSignature(sigma, signature);
                         for (const auto& elem : clean_decay) 
                         {
-                            const TParticlePDG* info = TDatabasePDG::Instance()->GetParticle(elem->PdgCode());
-                            if (info->Charge() != 0.0) 
+                            if (common::ParticleCharge(elem->PdgCode()) != 0) 
                             {
                                 std::cout << "Filling signature" << std::endl;
                                 this->fillSignature(elem, signature);
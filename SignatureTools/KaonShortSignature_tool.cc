@@ -19,6 +19,7 @@ public:
         , _BacktrackTag{pset.get<art::InputTag>("BacktrackTag", "gaushitTruthMatch")}
     {
         configure(pset);
+        _topology = this->registerTopology(pset.get<fhicl::ParameterSet>("Topology"));
     }
 
     ~KaonShortSignature() override = default;
@@ -38,19 +39,19 @@ private:
     art::InputTag _MCPproducer;
     art::InputTag _MCTproducer;
     art::InputTag _BacktrackTag;
+    size_t _topology;
 };
 
 void KaonShortSignature::findSignature(art::Event const& evt, Signature& signature, bool& signature_found)
 {
-    auto const &mcp_h = evt.getValidHandle<std::vector<simb::MCParticle>>(_MCPproducer);
-    std::map<int, art::Ptr<simb::MCParticle>> mcp_map;
-    for (size_t mcp_i = 0; mcp_i < mcp_h->size(); mcp_i++) {
-        const art::Ptr<simb::MCParticle> mcp(mcp_h, mcp_i);
-        mcp_map[mcp->TrackId()] = mcp;
-    }
-
-    auto addDaughterInteractions = [this, &signature, &mcp_map](const art::Ptr<simb::MCParticle>& particle, auto& self) -> void {
-        auto daughters = common::GetDaughters(mcp_map.at(particle->TrackId()), mcp_map);
+    auto const truth_graph = this->truthGraph(evt);
+    auto const matches = this->decayMatches(evt);
+    const common::DecayMatch& match = matches->at(_topology);
+    if (!match.found)
+        return;
+
+    auto addDaughterInteractions = [this, &signature, &truth_graph](const art::Ptr<simb::MCParticle>& particle, auto& self) -> void {
+        auto daughters = truth_graph->daughters(particle->TrackId());
         for (const auto& daugh : daughters) {
             if (daugh->PdgCode() == particle->PdgCode()) {
                 this->fillSignature(daugh, signature); 
@@ -59,73 +60,26 @@ void KaonShortSignature::findSignature(art::Event const& evt, Signature& signatu
         }
     };
 
-    for (const auto &mcp : *mcp_h) 
+    signature_found = true;
+    for (const auto &elem : match.signature) 
     {
-        if (abs(mcp.PdgCode()) == 311 && mcp.Process() == "primary" && mcp.EndProcess() == "Decay" && mcp.NumberDaughters() == 1 && !signature_found) 
-        {
-            auto dtrs = common::GetDaughters(mcp_map.at(mcp.TrackId()), mcp_map);
-            if (dtrs.size() != 1) continue; 
-
-            auto dtr = dtrs.at(0);
-            if (dtr->PdgCode() == 310 && dtr->Process() == "Decay" && dtr->EndProcess() == "Decay" && dtr->NumberDaughters() == 2 && !signature_found)
-            {
-                auto decay = common::GetDaughters(mcp_map.at(dtr->TrackId()), mcp_map);
-                if (decay.size() != 2) continue;
-                
-                std::vector<int> exp_decay = {-211, 211};
-                std::vector<int> fnd_decay;
-                
-                for (const auto &elem : decay) 
-                    fnd_decay.push_back(elem->PdgCode());
-
-                std::sort(exp_decay.begin(), exp_decay.end());
-                std::sort(fnd_decay.begin(), fnd_decay.end());
-
-                if (fnd_decay == exp_decay) 
-                {
-                    bool all_pass = std::all_of(decay.begin(), decay.end(), [&](const auto& elem) {
-                        return this->assessParticle(*elem);
-                    });
-
-                    if (all_pass) 
-                    {
-                        signature_found = true;
-                        for (const auto &elem : decay) 
-                        {
-                            const TParticlePDG* info = TDatabasePDG::Instance()->GetParticle(elem->PdgCode());
-                            if (info->Charge() != 0.0) 
-                            {
-                                this->fillSignature(elem, signature);
-                                addDaughterInteractions(elem, addDaughterInteractions);
-                            }
-                        }
-
-                        break;
-                    }
-                }
-            }
-        }
+        this->fillSignature(elem, signature);
+        addDaughterInteractions(elem, addDaughterInteractions);
     }
 }
 
 TVector3 KaonShortSignature::findVertex(art::Event const& evt) const
 {
-    auto const &mcp_h = evt.getValidHandle<std::vector<simb::MCParticle>>(_MCPproducer);
-    std::map<int, art::Ptr<simb::MCParticle>> mcp_map;
-    for (size_t mcp_i = 0; mcp_i < mcp_h->size(); mcp_i++) 
-    {
-        const art::Ptr<simb::MCParticle> mcp(mcp_h, mcp_i);
-        mcp_map[mcp->TrackId()] = mcp;
-    }
+    auto const truth_graph = this->truthGraph(evt);
 
-    for (const auto &mcp : *mcp_h) 
+    for (const auto &mcp : truth_graph->particles()) 
     {
-        if (abs(mcp.PdgCode()) == 311 && mcp.Process() == "primary" && mcp.EndProcess() == "Decay" && mcp.NumberDaughters() == 1) {
-            auto dtrs = common::GetDaughters(mcp_map.at(mcp.TrackId()), mcp_map);
+        if (abs(mcp->PdgCode()) == 311 && truth_graph->process(mcp) == common::kProcessPrimary && truth_graph->endProcess(mcp) == common::kProcessDecay && mcp->NumberDaughters() == 1) {
+            auto dtrs = truth_graph->daughters(mcp);
             if (dtrs.size() != 1) continue; 
 
             auto dtr = dtrs.at(0);
-            if (dtr->PdgCode() == 310 && dtr->Process() == "Decay" && dtr->EndProcess() == "Decay" && dtr->NumberDaughters() == 2)
+            if (dtr->PdgCode() == 310 && truth_graph->process(dtr) == common::kProcessDecay && truth_graph->endProcess(dtr) == common::kProcessDecay && dtr->NumberDaughters() == 2)
             {
                 const TLorentzVector& end_position = dtr->EndPosition();
                 
@@ -31,13 +31,11 @@ private:
 
 void MuonSignature::findSignature(art::Event const& evt, Signature& signature, bool& signature_found)
 {
-    auto const &mcp_h = evt.getValidHandle<std::vector<simb::MCParticle>>(_MCPproducer);
-    std::vector<art::Ptr<simb::MCParticle>> mcp_vec;
-    art::fill_ptr_vector(mcp_vec, mcp_h);
+    auto const truth_graph = this->truthGraph(evt);
 
-    for (const auto& mcp : mcp_vec) 
+    for (const auto& mcp : truth_graph->particles()) 
     {
-        if (std::abs(mcp->PdgCode()) == 13 && mcp->Process() == "primary" && this->assessParticle(*mcp)) 
+        if (std::abs(mcp->PdgCode()) == 13 && truth_graph->process(mcp) == common::kProcessPrimary && this->assessParticle(*mcp)) 
         {
             signature_found = true;
             this->fillSignature(mcp, signature);
@@ -0,0 +1,115 @@
+#ifndef SIGNATURE_PATTERNSOURCE_H
+#define SIGNATURE_PATTERNSOURCE_H
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "art/Utilities/make_tool.h"
+#include "canvas/Utilities/InputTag.h"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include "DataProducts/SignatureRecord.h"
+#include "SignatureTools/SignatureToolBase.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace signature {
+
+// The pattern of a module's SignatureTools table for an event. Signatures
+// are read from the SignatureProducer product where it holds a record under
+// the same tool label made with an identical tool configuration, and found
+// by running the module's own tool only when it does not, so chained modules
+// search the truth once per event.
+//
+//   SignatureProducer: "signatures"   # empty to always run the tools
+//   SignatureTools: { leptonic: @local::MuonSignature ... }
+class PatternSource
+{
+public:
+    explicit PatternSource(const fhicl::ParameterSet& pset)
+        : _SignatureProducer{pset.get<art::InputTag>("SignatureProducer", "signatures")}
+        , _MCPproducer{pset.get<art::InputTag>("MCPproducer", "largeant")}
+    {
+        const fhicl::ParameterSet& tool_psets = pset.get<fhicl::ParameterSet>("SignatureTools");
+        for (auto const& tool_pset_label : tool_psets.get_pset_names())
+        {
+            auto const tool_pset = tool_psets.get<fhicl::ParameterSet>(tool_pset_label);
+            _labels.push_back(tool_pset_label);
+            _tool_types.push_back(tool_pset.get<std::string>("tool_type"));
+            _pset_ids.push_back(tool_pset.id().to_string());
+            _tools.push_back(art::make_tool<SignatureToolBase>(tool_pset));
+        }
+    }
+
+    size_t size() const { return _tools.size(); }
+
+    // Fills patt in tool order; false, with patt partially filled, as soon
+    // as one signature is not found.
+    bool load(const art::Event& e, Pattern& patt) const
+    {
+        art::Handle<std::vector<SignatureRecord>> record_h;
+        if (!_SignatureProducer.label().empty())
+            e.getByLabel(_SignatureProducer, record_h);
+
+        std::shared_ptr<const common::TruthGraph> truth_graph;
+        for (size_t i = 0; i < _tools.size(); ++i)
+        {
+            const SignatureRecord* record = record_h.isValid() ? this->findRecord(*record_h, i) : nullptr;
+
+            Signature signature;
+            if (record == nullptr)
+            {
+                if (!_tools[i]->constructSignature(e, signature))
+                    return false;
+            }
+            else
+            {
+                if (!record->found)
+                    return false;
+
+                if (!truth_graph)
+                    truth_graph = art::ServiceHandle<TruthGraphService>()->graph(e, _MCPproducer);
+                for (int track_id : record->track_ids)
+                    signature.push_back(truth_graph->at(track_id));
+            }
+
+            patt.push_back(signature);
+        }
+
+        return true;
+    }
+
+private:
+    art::InputTag _SignatureProducer, _MCPproducer;
+    std::vector<std::string> _labels;
+    std::vector<std::string> _tool_types;
+    std::vector<std::string> _pset_ids;
+    std::vector<std::unique_ptr<SignatureToolBase>> _tools;
+
+    const SignatureRecord* findRecord(const std::vector<SignatureRecord>& records, size_t i) const
+    {
+        for (const auto& record : records)
+        {
+            if (record.label != _labels[i])
+                continue;
+
+            if (record.tool_type != _tool_types[i])
+                throw cet::exception("PatternSource") << "Signature " << _labels[i] << " is a " << _tool_types[i] << " here but a "
+                    << record.tool_type << " in " << _SignatureProducer;
+
+            // Same tool, other thresholds or inputs: its result is not ours.
+            if (record.tool_pset_id != _pset_ids[i])
+                return nullptr;
+
+            return &record;
+        }
+
+        return nullptr;
+    }
+};
+
+}
+
+#endif
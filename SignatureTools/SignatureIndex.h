@@ -0,0 +1,46 @@
+#ifndef SIGNATURE_INDEX_H
+#define SIGNATURE_INDEX_H
+
+#include "SignatureTools/SignatureToolBase.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace signature {
+
+using SignatureMask = uint64_t;
+
+// TrackId -> bitmask of the signatures (by position in the pattern) that
+// contain the particle, built once per event so that labelling a hit is a
+// single lookup.
+class SignatureIndex
+{
+public:
+    static constexpr size_t kMaxSignatures = 64;
+
+    explicit SignatureIndex(const Pattern& patt)
+    {
+        if (patt.size() > kMaxSignatures)
+            throw cet::exception("SignatureIndex") << "Pattern has " << patt.size() << " signatures, at most " << kMaxSignatures << " are supported";
+
+        for (size_t sig_ctr = 0; sig_ctr < patt.size(); ++sig_ctr) {
+            for (const auto& mcp : patt[sig_ctr])
+                _masks[mcp->TrackId()] |= SignatureMask(1) << sig_ctr;
+        }
+    }
+
+    SignatureMask mask(int track_id) const
+    {
+        auto it = _masks.find(track_id);
+        return it != _masks.end() ? it->second : 0;
+    }
+
+    bool empty() const { return _masks.empty(); }
+
+private:
+    std::unordered_map<int, SignatureMask> _masks;
+};
+
+}
+
+#endif
@@ -10,8 +10,6 @@
 #include "CommonFunctions/Types.h"
 #include "TTree.h"
 #include <limits>
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
 
 #include "nusimdata/SimulationBase/MCParticle.h"
 #include "nusimdata/SimulationBase/MCParticle.h"
@@ -21,6 +19,11 @@
 #include "CommonFunctions/Scatters.h"
 #include "CommonFunctions/Corrections.h"
 #include "CommonFunctions/Containment.h"
+#include "CommonFunctions/ParticleTable.h"
+#include "CommonFunctions/TruthGraph.h"
+#include "CommonFunctions/DecayTopology.h"
+
+#include "Services/TruthGraphService.h"
 
 namespace signature {
 
@@ -37,6 +40,7 @@ public:
     {
         _MCPproducer = pset.get<art::InputTag>("MCPproducer", "largeant");
         _MCTproducer = pset.get<art::InputTag>("MCTproducer", "generator");
+        _thresholds.configure(pset);
     }
 
     bool constructSignature(art::Event const& evt, Signature& signature)
@@ -57,31 +61,35 @@ public:
 
 protected:
     art::InputTag _MCPproducer, _MCTproducer;
+    common::ParticleThresholds _thresholds;
 
+    // Neutral particles always pass; charged ones must be above their
+    // species' momentum threshold (see common::kParticleTable), and charged
+    // species without one, nuclei included, never pass.
     bool assessParticle(const simb::MCParticle& mcp) const 
     {
-        float mom_mag = mcp.Momentum().Vect().Mag();
-        int abs_pdg = std::abs(mcp.PdgCode());
-
-        const TParticlePDG* particle = TDatabasePDG::Instance()->GetParticle(mcp.PdgCode());
-        if (particle->Charge() == 0.0) 
-            return true;
-
-        std::unordered_map<int, float> thresh_map = {
-            {211, 0.1},    // pi
-            {13, 0.1},     // mu
-            {2212, 0.1},   // p
-            {321, 0.1},    // K
-            {11, 0.1},     // e
-            {3222, 0.1},   // sigma+
-            {3112, 0.1},   // sigma-
-        };
-
-        auto it = thresh_map.find(abs_pdg);
-        if (it != thresh_map.end())
-            return mom_mag > it->second;
-
-        return false;
+        return _thresholds.passes(mcp);
+    }
+
+    // The event's MCParticle graph, shared with every other tool and module
+    // that asks for it during this event.
+    std::shared_ptr<const common::TruthGraph> truthGraph(art::Event const& evt) const
+    {
+        return art::ServiceHandle<TruthGraphService>()->graph(evt, _MCPproducer);
+    }
+
+    // Declares a decay topology (see common::DecayNode) to be matched
+    // alongside those of every other tool; returns its index in matches().
+    // Its signature particles are held to this tool's thresholds, so call
+    // it after configure().
+    size_t registerTopology(fhicl::ParameterSet const& topology_pset)
+    {
+        return art::ServiceHandle<TruthGraphService>()->registerTopology(common::MakeDecayNode(topology_pset), _thresholds);
+    }
+
+    std::shared_ptr<const common::DecayMatches> decayMatches(art::Event const& evt) const
+    {
+        return art::ServiceHandle<TruthGraphService>()->matches(evt, _MCPproducer);
     }
 
     void fillSignature(const art::Ptr<simb::MCParticle>& mcp, Signature& signature) 
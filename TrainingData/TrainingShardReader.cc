@@ -0,0 +1,51 @@
+#include "ConvolutionNetwork/TrainingShardReader.h"
+
+#include <string>
+#include <vector>
+
+// C interface used by the Python loader (training_shards.py) through ctypes.
+
+namespace
+{
+    thread_local std::string last_error;
+}
+
+extern "C"
+{
+    void* tsr_open(const char** paths, int n_paths)
+    {
+        try {
+            std::vector<std::string> files(paths, paths + n_paths);
+            return new network::TrainingShardReader(files);
+        } catch (const std::exception& e) {
+            last_error = e.what();
+            return nullptr;
+        }
+    }
+
+    void tsr_close(void* reader)
+    {
+        delete static_cast<network::TrainingShardReader*>(reader);
+    }
+
+    long tsr_size(void* reader)
+    {
+        return static_cast<long>(static_cast<network::TrainingShardReader*>(reader)->size());
+    }
+
+    int tsr_event(void* reader, long i, network::TrainingEvent* evt)
+    {
+        try {
+            *evt = static_cast<network::TrainingShardReader*>(reader)->event(static_cast<size_t>(i));
+            return 0;
+        } catch (const std::exception& e) {
+            last_error = e.what();
+            return -1;
+        }
+    }
+
+    const char* tsr_last_error()
+    {
+        return last_error.c_str();
+    }
+}
@@ -0,0 +1,109 @@
+"""Random-access loader for ConvolutionNetworkAlgo training samples.
+
+Wraps libTrainingShardReader through ctypes. Works on binary shards
+(TrainingOutputFormat: "shards") and on the merged training_output_<view>.csv
+files, for which an event-offset index is built once and cached next to the
+file as <file>.idx.
+
+    shards = TrainingShards(sorted(glob.glob("training_output_W_*.bin")))
+    meta, hits = shards[i]   # hits has shape (n_hits, 3 + n_flag_words)
+    flags = unpack_flags(meta, hits)   # shape (n_hits, n_flags)
+"""
+
+import ctypes
+import os
+
+import numpy as np
+
+_META_FLAG_WORDS = 14
+_FLAG_BITS_PER_WORD = 16
+
+
+def unpack_flags(meta, hits):
+    """Return the (n_hits, n_flags) 0/1 signature flags of an event.
+
+    Flags are stored as 16-bit integer values in the float32 words after
+    (x, z, q); older samples without the n_flag_words meta field store one
+    0/1 float per flag and are returned as they are.
+    """
+    n_flags = int(meta[1])
+    if len(meta) <= _META_FLAG_WORDS:
+        return hits[:, 3:3 + n_flags].astype(np.uint8)
+
+    n_words = int(meta[_META_FLAG_WORDS])
+    words = hits[:, 3:3 + n_words].astype(np.uint64)
+    bits = np.arange(n_flags, dtype=np.uint64)
+    word_of_bit = bits // _FLAG_BITS_PER_WORD
+    shift = bits % _FLAG_BITS_PER_WORD
+    return ((words[:, word_of_bit] >> shift) & 1).astype(np.uint8)
+
+
+class _TrainingEvent(ctypes.Structure):
+    _fields_ = [
+        ("meta", ctypes.POINTER(ctypes.c_float)),
+        ("hits", ctypes.POINTER(ctypes.c_float)),
+        ("n_meta", ctypes.c_uint32),
+        ("n_hits", ctypes.c_uint32),
+        ("n_flags", ctypes.c_uint32),
+        ("n_flag_words", ctypes.c_uint32),
+        ("run", ctypes.c_int32),
+        ("subrun", ctypes.c_int32),
+        ("event", ctypes.c_int32),
+        ("zero_copy", ctypes.c_bool),
+    ]
+
+
+def _load_library():
+    lib = ctypes.CDLL(os.environ.get("TRAINING_SHARD_READER_LIB", "libTrainingShardReader.so"))
+    lib.tsr_open.restype = ctypes.c_void_p
+    lib.tsr_open.argtypes = [ctypes.POINTER(ctypes.c_char_p), ctypes.c_int]
+    lib.tsr_close.argtypes = [ctypes.c_void_p]
+    lib.tsr_size.restype = ctypes.c_long
+    lib.tsr_size.argtypes = [ctypes.c_void_p]
+    lib.tsr_event.restype = ctypes.c_int
+    lib.tsr_event.argtypes = [ctypes.c_void_p, ctypes.c_long, ctypes.POINTER(_TrainingEvent)]
+    lib.tsr_last_error.restype = ctypes.c_char_p
+    return lib
+
+
+class TrainingShards(object):
+    def __init__(self, paths):
+        self._lib = _load_library()
+        encoded = [p.encode() for p in paths]
+        array = (ctypes.c_char_p * len(encoded))(*encoded)
+        self._reader = self._lib.tsr_open(array, len(encoded))
+        if not self._reader:
+            raise IOError(self._lib.tsr_last_error().decode())
+
+    def __len__(self):
+        return self._lib.tsr_size(self._reader)
+
+    def __getitem__(self, i):
+        """Return (meta, hits) for event i.
+
+        For uncompressed shards both arrays are read-only views of the mapped
+        file; otherwise they are copies of the reader's decode buffer.
+        """
+        evt = _TrainingEvent()
+        if self._lib.tsr_event(self._reader, int(i), ctypes.byref(evt)) != 0:
+            raise IndexError(self._lib.tsr_last_error().decode())
+
+        packed = evt.n_meta > _META_FLAG_WORDS
+        width = 3 + (evt.n_flag_words if packed else evt.n_flags)
+        meta = np.ctypeslib.as_array(evt.meta, shape=(evt.n_meta,))
+        hits = np.ctypeslib.as_array(evt.hits, shape=(evt.n_hits * width,)).reshape(evt.n_hits, width)
+
+        if evt.zero_copy:
+            meta.flags.writeable = False
+            hits.flags.writeable = False
+            return meta, hits
+
+        return meta.copy(), hits.copy()
+
+    def close(self):
+        if self._reader:
+            self._lib.tsr_close(self._reader)
+            self._reader = None
+
+    def __del__(self):
+        self.close()
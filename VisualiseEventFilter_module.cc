@@ -1,4 +1,4 @@
-#include "art/Framework/Core/EDFilter.h"
+#include "art/Framework/Core/SharedFilter.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
@@ -20,6 +20,7 @@
 #include "CommonFunctions/Pandora.h"
 #include "CommonFunctions/Scatters.h"
 #include "CommonFunctions/Visualisation.h"
+#include "CommonFunctions/FilterPipeline.h"
 
 #include "lardataobj/AnalysisBase/BackTrackerMatchingData.h"
 #include "lardataobj/AnalysisBase/Calorimetry.h"
@@ -35,15 +36,19 @@
 #include "lardataobj/RecoBase/Track.h"
 
 #include "SignatureTools/SignatureToolBase.h"
+#include "SignatureTools/PatternSource.h"
 #include "SignatureTools/VertexToolBase.h"
 
+#include "Services/VisualisationService.h"
+
 #include <vector>
 #include <map>
 #include <algorithm>
 #include <string>
 #include <tuple>
+#include <atomic>
 
-class VisualiseEventFilter : public art::EDFilter
+class VisualiseEventFilter : public art::SharedFilter
 {
 public:
     explicit VisualiseEventFilter(fhicl::ParameterSet const &pset);
@@ -53,7 +58,10 @@ public:
     VisualiseEventFilter &operator=(VisualiseEventFilter const &) = delete;
     VisualiseEventFilter &operator=(VisualiseEventFilter &&) = delete;
 
-    bool filter(art::Event &e) override;
+    bool filter(art::Event &e, art::ProcessingFrame const &frame) override;
+    void beginJob(art::ProcessingFrame const &frame) override;
+    void beginRun(art::Run const &r, art::ProcessingFrame const &frame) override;
+    void endJob(art::ProcessingFrame const &frame) override;
 
 private:
     art::InputTag _HitProducer, _MCPproducer, _MCTproducer, _BacktrackTag;
@@ -61,16 +69,29 @@ private:
     std::string _mode;
     std::vector<std::tuple<int, int, int>> _target_events;
 
-    std::vector<std::unique_ptr<::signature::SignatureToolBase>> _signatureToolsVec;
+    ::signature::PatternSource _pattern_source;
+
+    struct FilterContext
+    {
+        art::Event &e;
+        signature::Pattern pattern;
+    };
+
+    common::FilterPipeline<FilterContext> _pipeline;
+    std::atomic<size_t> _n_visualised{0};
+
+    bool isTargetEvent(const art::Event &e) const;
+    bool constructPattern(art::Event &e, signature::Pattern& pattern) const;
 };
 
 VisualiseEventFilter::VisualiseEventFilter(fhicl::ParameterSet const &pset)
-    : EDFilter{pset}
+    : SharedFilter{pset}
     , _HitProducer{pset.get<art::InputTag>("HitProducer", "gaushit")}
     , _MCPproducer{pset.get<art::InputTag>("MCPproducer", "largeant")}
     , _MCTproducer{pset.get<art::InputTag>("MCTproducer", "generator")}
     , _BacktrackTag{pset.get<art::InputTag>("BacktrackTag", "gaushitTruthMatch")}
     , _mode{pset.get<std::string>("Mode", "nominal")}
+    , _pattern_source{pset}
 {
     if (pset.has_key("TargetEvents")) {
         for (auto const &entry : pset.get<std::vector<std::vector<int>>>("TargetEvents")) {
@@ -85,15 +106,51 @@ VisualiseEventFilter::VisualiseEventFilter(fhicl::ParameterSet const &pset)
             _target_events.emplace_back(run, subrun, event);
     }
 
-    const fhicl::ParameterSet &tool_psets = pset.get<fhicl::ParameterSet>("SignatureTools");
-    for (auto const &tool_pset_label : tool_psets.get_pset_names())
-    {
-        auto const tool_pset = tool_psets.get<fhicl::ParameterSet>(tool_pset_label);
-        _signatureToolsVec.push_back(art::make_tool<::signature::SignatureToolBase>(tool_pset));
-    };
+    _pipeline.addProduct("mcparticles", 10.);
+    _pipeline.addStage("target", 0., {}, [this](FilterContext &ctx) { return this->isTargetEvent(ctx.e); });
+    _pipeline.addStage("pattern", 1., {"mcparticles"}, [this](FilterContext &ctx) { return this->constructPattern(ctx.e, ctx.pattern); });
+    _pipeline.order();
+
+    serialize<art::InEvent>();
+}
+
+void VisualiseEventFilter::beginJob(art::ProcessingFrame const &)
+{
+    common::PandoraGeometryLUT::Instance();
+}
+
+void VisualiseEventFilter::beginRun(art::Run const &r, art::ProcessingFrame const &)
+{
+    common::PandoraGeometryLUT::Instance().updateDrift();
+}
+
+void VisualiseEventFilter::endJob(art::ProcessingFrame const &)
+{
+    art::ServiceHandle<VisualisationService>()->flush();
+    mf::LogInfo("VisualiseEventFilter") << "Rendered " << _n_visualised << " event displays";
+
+    for (const auto& stage : _pipeline.stats())
+        mf::LogInfo("VisualiseEventFilter") << "Stage " << stage.name << ": ran " << stage.n_run << ", rejected " << stage.n_rejected 
+            << ", " << stage.seconds << " s";
+}
+
+bool VisualiseEventFilter::filter(art::Event &e, art::ProcessingFrame const &)
+{
+    FilterContext ctx{e, {}};
+    if (!_pipeline.run(ctx))
+        return false;
+
+    common::EventSnapshot snapshot;
+    std::string filename = "event_" + std::to_string(e.run()) + "_" + std::to_string(e.subRun()) + "_" + std::to_string(e.event());
+    common::SnapshotEvent(e, _MCPproducer, _HitProducer, _BacktrackTag, ctx.pattern, filename, snapshot);
+    snapshot.render_signature = true;
+    art::ServiceHandle<VisualisationService>()->push(std::move(snapshot));
+    _n_visualised += 1;
+
+    return true;
 }
 
-bool VisualiseEventFilter::filter(art::Event &e)
+bool VisualiseEventFilter::isTargetEvent(const art::Event &e) const
 {
     if (_target_events.empty()) 
         return false;
@@ -106,19 +163,12 @@ bool VisualiseEventFilter::filter(art::Event &e)
             return false;
     }
 
-    signature::Pattern pattern;
-    for (auto& signatureTool : _signatureToolsVec) {
-        signature::Signature signature;
-        if (!signatureTool->constructSignature(e, signature))
-            return false;
-
-        pattern.push_back(signature);
-    }
-
-    std::string filename = "event_" + std::to_string(e.run()) + "_" + std::to_string(e.subRun()) + "_" + std::to_string(e.event());
-    common::visualiseSignature(e, _MCPproducer, _HitProducer, _BacktrackTag, pattern, filename);
-
     return true;
 }
 
+bool VisualiseEventFilter::constructPattern(art::Event &e, signature::Pattern& pattern) const
+{
+    return _pattern_source.load(e, pattern);
+}
+
 DEFINE_ART_MODULE(VisualiseEventFilter)